@@ -0,0 +1,183 @@
+#pragma once
+
+#include <cmath>        // For exp, expm1, fabs, lgamma, log, log1p and pow
+
+#include "Results.h"    // For ConfidenceInterval
+
+/*
+ * Adaptive sample sizes: simulate a bankroll in batches until its ruin probability is
+ * known to a target precision, instead of always running TOTAL_RUNS.
+ *
+ * Stopping the first time an interval looks narrow enough is not valid by itself: with
+ * enough looks, some 95% interval will eventually exclude the truth. So look j uses
+ * an exact (Clopper-Pearson) interval at level alpha_j = 6 alpha / (pi^2 j^2). These sum
+ * to alpha over all j, so by the union bound every interval ever computed covers the true
+ * probability at once with probability at least 1 - alpha, and in particular the one
+ * the run stopped at does, whatever the stopping rule looked at.
+ *
+ * Looks happen when the number of runs doubles, so a bankroll that needs N runs costs at
+ * most about 2N and uses about log2(N / first batch) looks; alpha_j shrinks only as 1/j^2,
+ * which widens the intervals far less than looking after every batch would.
+ *
+ * Batches are whole ranges of run indices, so the runs simulated and the point at which
+ * a bankroll stops do not depend on the thread count.
+ */
+
+/**
+ * @brief The continued fraction of the regularized incomplete beta function (modified
+ * Lentz), which converges quickly for x < (a + 1) / (a + b + 2).
+ */
+inline double incompleteBetaFraction(double a, double b, double x) {
+    const double TINY = 1e-300;
+    const double EPSILON = 1e-15;
+    const int MAX_ITERATIONS = 100000;
+
+    double c = 1.0;
+    double d = 1.0 - (a + b) * x / (a + 1.0);
+    if (std::fabs(d) < TINY) d = TINY;
+    d = 1.0 / d;
+    double fraction = d;
+    for (int m = 1; m <= MAX_ITERATIONS; ++m) {
+        double m2 = 2.0 * m;
+
+        // Even step
+        double numerator = m * (b - m) * x / ((a + m2 - 1.0) * (a + m2));
+        d = 1.0 + numerator * d;
+        if (std::fabs(d) < TINY) d = TINY;
+        c = 1.0 + numerator / c;
+        if (std::fabs(c) < TINY) c = TINY;
+        d = 1.0 / d;
+        fraction *= d * c;
+
+        // Odd step
+        numerator = -(a + m) * (a + b + m) * x / ((a + m2) * (a + m2 + 1.0));
+        d = 1.0 + numerator * d;
+        if (std::fabs(d) < TINY) d = TINY;
+        c = 1.0 + numerator / c;
+        if (std::fabs(c) < TINY) c = TINY;
+        d = 1.0 / d;
+        double delta = d * c;
+        fraction *= delta;
+        if (std::fabs(delta - 1.0) < EPSILON) break;
+    }
+    return fraction;
+}
+
+/**
+ * @brief The regularized incomplete beta function I_x(a, b). Small values are accurate
+ * to full relative precision, which is what the interval bounds below are solved in.
+ */
+inline double incompleteBeta(double a, double b, double x) {
+    if (x <= 0.0) return 0.0;
+    if (x >= 1.0) return 1.0;
+    double logFront = std::lgamma(a + b) - std::lgamma(a) - std::lgamma(b) + a * std::log(x) + b * std::log1p(-x);
+    if (x < (a + 1.0) / (a + b + 2.0)) {
+        return std::exp(logFront) * incompleteBetaFraction(a, b, x) / a;
+    }
+    return 1.0 - std::exp(logFront) * incompleteBetaFraction(b, a, 1.0 - x) / b;
+}
+
+/**
+ * @brief Solves tail(p) = target for p in [0, 1], for an increasing tail(p), by bisection.
+ */
+template <typename Tail>
+double solveIncreasing(Tail tail, double target) {
+    double low = 0.0;
+    double high = 1.0;
+    // Until the bracket is tight relative to its upper end, so tiny solutions keep their digits
+    while (high - low > 1e-12 * high) {
+        double middle = 0.5 * (low + high);
+        if (tail(middle) < target) low = middle;
+        else high = middle;
+    }
+    return 0.5 * (low + high);
+}
+
+/**
+ * @brief The exact (Clopper-Pearson) two-sided interval for a binomial proportion at
+ * level 1 - alpha. Conservative: it covers the truth with probability at least 1 - alpha.
+ */
+inline ConfidenceInterval clopperPearsonInterval(long long successes, long long trials, double alpha) {
+    ConfidenceInterval interval;
+    if (trials <= 0) {
+        interval.high = 1.0;
+        return interval;
+    }
+    const double x = static_cast<double>(successes);
+    const double n = static_cast<double>(trials);
+    const double tail = 0.5 * alpha;
+
+    // Lower bound: P(X >= x | p) = I_p(x, n - x + 1) = tail
+    if (successes == 0) {
+        interval.low = 0.0;
+    }
+    else if (successes == trials) {
+        interval.low = std::pow(tail, 1.0 / n);
+    }
+    else {
+        interval.low = solveIncreasing([&](double p) { return incompleteBeta(x, n - x + 1.0, p); }, tail);
+    }
+
+    // Upper bound: P(X <= x | p) = I_(1-p)(n - x, x + 1) = tail, solved for q = 1 - p
+    if (successes == trials) {
+        interval.high = 1.0;
+    }
+    else if (successes == 0) {
+        interval.high = -std::expm1(std::log(tail) / n);
+    }
+    else {
+        double q = solveIncreasing([&](double q) { return incompleteBeta(n - x, x + 1.0, q); }, tail);
+        interval.high = 1.0 - q;
+    }
+    return interval;
+}
+
+/**
+ * @brief When to stop simulating a bankroll.
+ */
+struct StoppingRule {
+    double absoluteHalfWidth = 0.0;   // Stop once the interval's half-width is at most this (0 = unused)
+    double relativeHalfWidth = 0.0;   // ... or at most this fraction of the estimate (0 = unused)
+    double alpha = 0.05;              // Overall error probability of the sequence of intervals
+    long long maxRuns = 0;            // Budget: never simulate more runs than this
+
+    bool enabled() const { return absoluteHalfWidth > 0.0 || relativeHalfWidth > 0.0; }
+};
+
+/**
+ * @brief The level of the interval at look j (1, 2, ...): 6 alpha / (pi^2 j^2).
+ */
+inline double lookAlpha(double alpha, int look) {
+    const double PI_SQUARED = 9.869604401089358;
+    return 6.0 * alpha / (PI_SQUARED * static_cast<double>(look) * static_cast<double>(look));
+}
+
+/**
+ * @brief The interval at a look, for a ruin probability estimated as weight * ruins / runs
+ * (weight 1 for plain Monte Carlo; see importanceWeight for importance sampling).
+ */
+inline ConfidenceInterval sequentialInterval(long long ruins, long long runs, double weight, double alpha, int look) {
+    return scaledInterval(clopperPearsonInterval(ruins, runs, lookAlpha(alpha, look)), weight);
+}
+
+/**
+ * @brief True once an interval around an estimate meets the rule's precision target.
+ * A relative target is never met while the estimate is zero.
+ */
+inline bool stoppingTargetMet(const StoppingRule& rule, const ConfidenceInterval& interval, double estimate) {
+    double halfWidth = 0.5 * (interval.high - interval.low);
+    if (rule.absoluteHalfWidth > 0.0 && halfWidth <= rule.absoluteHalfWidth) return true;
+    if (rule.relativeHalfWidth > 0.0 && estimate > 0.0 && halfWidth <= rule.relativeHalfWidth * estimate) return true;
+    return false;
+}
+
+/**
+ * @brief The number of runs to have simulated by the next look: 16 chunks first, then
+ * twice as many each time, always a whole number of chunks and never past the budget.
+ * @param runsDone Runs simulated so far (a whole number of chunks).
+ */
+inline long long nextLookRuns(long long runsDone, long long runsPerChunk, long long maxRuns) {
+    long long next = (runsDone == 0) ? 16 * runsPerChunk : 2 * runsDone;
+    next = (next + runsPerChunk - 1) / runsPerChunk * runsPerChunk;
+    return (next < maxRuns) ? next : maxRuns;
+}
@@ -0,0 +1,217 @@
+#pragma once
+
+#include <algorithm>    // For partition_point
+#include <cmath>        // For floor and log
+#include <cstdint>
+#include <iomanip>      // For setw and setprecision
+#include <iostream>
+#include <vector>
+
+#include "ThreadPool.h"
+#include "Lattice.h"
+#include "Sweep.h"      // For summarizeWalk
+#include "ClosedForm.h" // For closedFormRuinProbability
+#include "Adaptive.h"   // For clopperPearsonInterval
+
+/*
+ * Searching for the smallest bankroll that meets a target ruin probability.
+ *
+ * A start of s units is ruined exactly when its walk falls s units at some bet (see
+ * Sweep.h), so one set of walks answers every candidate at once. Each walk is reduced to
+ * its depth D, how far below the start it ever fell; the runs ruined from s are those with
+ * D >= s. A walk of n bets falls at most n units, so the depths fit a histogram of n + 2
+ * counts, merged from one per thread like the other histograms, and the runs ruined from
+ * every start are its running totals from the top: O(n) memory and no per-run storage.
+ * The ruin count falls as the start grows, so the smallest start that allows at most k
+ * ruins is the first one whose count is at most k, and the search is over k, not over
+ * bankrolls.
+ *
+ * "At confidence c" means the one-sided Clopper-Pearson upper bound of the ruin
+ * probability (level c) is at most the target. The bound grows with k, so the answer is
+ * the smallest start allowing the largest k whose bound is still at most the target.
+ * Looking at every candidate does not need a multiplicity correction: let s0 be the
+ * largest start whose true ruin probability is above the target. The search can only
+ * settle at or below s0 if some start no larger than s0 passed the bound. That start has
+ * at least as many ruins as s0, so s0 would have passed too, which happens with
+ * probability at most 1 - c.
+ *
+ * The fixed-bet game also has an exact answer: the closed form (see ClosedForm.h) is
+ * decreasing in the start, so bisection finds it in O(numBets log numBets).
+ */
+
+/**
+ * @brief How deep a set of walks fell: ruinsFrom[s] runs were ruined from a start of s units,
+ * for s from 0 to numBets + 1 (where it is always 0).
+ */
+struct RuinDepths {
+    long long runs = 0;
+    std::vector<long long> ruinsFrom;
+};
+
+/**
+ * @brief Simulates totalRuns walks once each, to the end, and counts how far below its start
+ * each one fell. Counts are integers, so they do not depend on the thread count.
+ */
+inline RuinDepths simulateRuinDepths(ThreadPool& pool, BetPatternGenerator generate, PhiloxKey streamKey,
+    long long numBets, const BernoulliThreshold& houseWin, long long totalRuns, long long runsPerChunk) {
+    // Bin d + 1 counts the walks of depth d; bin 0 those that never came down to their start.
+    // Each chunk keeps its runs' bins and adds them to its thread's histogram once, as in simulateEdgeSweep
+    // (a chunk-local histogram would be numBets long, where the bins are only runsPerChunk)
+    const std::size_t bins = static_cast<std::size_t>(numBets) + 2;
+    std::vector<CacheLinePadded<std::vector<long long>>> depthsByThread(pool.size());
+    for (CacheLinePadded<std::vector<long long>>& slot : depthsByThread) {
+        slot.value.assign(bins, 0);
+    }
+    const std::vector<std::int64_t> noLevels;
+
+    pool.parallelFor(totalRuns, runsPerChunk, [&](unsigned threadIndex, long long begin, long long end) {
+        std::vector<std::size_t> chunkBins(static_cast<std::size_t>(end - begin));
+        for (long long i = begin; i < end; ++i) {
+            WalkSummary walk = summarizeWalk(generate, streamKey, numBets, houseWin, i, noLevels, nullptr);
+            // (No bets leaves the minimum at the int64 maximum, which lands in bin 0)
+            std::int64_t depth = (walk.minimum > 0) ? -1 : -walk.minimum;
+            chunkBins[static_cast<std::size_t>(i - begin)] = static_cast<std::size_t>(depth + 1);
+        }
+        std::vector<long long>& counts = depthsByThread[threadIndex].value;
+        for (std::size_t bin : chunkBins) counts[bin]++;
+    });
+
+    // A walk of depth d is ruined from every start up to d
+    RuinDepths depths;
+    depths.runs = totalRuns;
+    depths.ruinsFrom.assign(bins, 0);
+    long long deeper = 0;
+    for (std::size_t bin = bins; bin-- > 1;) {
+        for (const CacheLinePadded<std::vector<long long>>& slot : depthsByThread) {
+            deeper += slot.value[bin];
+        }
+        depths.ruinsFrom[bin - 1] = deeper;
+    }
+    return depths;
+}
+
+/**
+ * @brief The number of runs ruined from a start of startUnits (at least 0).
+ */
+inline long long ruinsFromDepths(const RuinDepths& depths, std::int64_t startUnits) {
+    if (startUnits >= static_cast<std::int64_t>(depths.ruinsFrom.size())) return 0;
+    return depths.ruinsFrom[static_cast<std::size_t>(startUnits)];
+}
+
+/**
+ * @brief The smallest start, in bet units, from which at most maxRuins of the runs are ruined.
+ */
+inline std::int64_t smallestStartAllowing(const RuinDepths& depths, long long maxRuins) {
+    // The counts fall as the start grows, and the last one is 0
+    std::vector<long long>::const_iterator first = std::partition_point(depths.ruinsFrom.begin(), depths.ruinsFrom.end(),
+        [maxRuins](long long ruins) { return ruins > maxRuins; });
+    return static_cast<std::int64_t>(first - depths.ruinsFrom.begin());
+}
+
+/**
+ * @brief The one-sided upper confidence bound of a ruin probability at level confidence.
+ */
+inline double ruinUpperBound(long long ruins, long long runs, double confidence) {
+    // The high end of the two-sided interval at level 1 - 2 (1 - confidence)
+    return clopperPearsonInterval(ruins, runs, 2.0 * (1.0 - confidence)).high;
+}
+
+/**
+ * @brief The most ruins out of runs whose upper bound (at level confidence) is still at most
+ * target, or -1 if even none would not show the target is met.
+ */
+inline long long mostRuinsWithin(long long runs, double target, double confidence) {
+    if (ruinUpperBound(0, runs, confidence) > target) return -1;
+    long long low = 0;      // Known to pass
+    long long high = runs;  // Passes only if the target is 1
+    if (ruinUpperBound(high, runs, confidence) <= target) return high;
+    while (high - low > 1) {
+        long long middle = low + (high - low) / 2;
+        if (ruinUpperBound(middle, runs, confidence) <= target) low = middle;
+        else high = middle;
+    }
+    return low;
+}
+
+/**
+ * @brief The smallest start, in bet units, whose exact ruin probability is at most target.
+ * @param table Log-factorials up to at least numBets.
+ */
+inline std::int64_t exactSmallestStart(const LogFactorialTable& table, long long numBets, double houseWinProb, double target) {
+    // No walk of numBets bets can fall numBets + 1 units, so that start always qualifies
+    std::int64_t low = 0;
+    std::int64_t high = numBets + 1;
+    if (closedFormRuinProbability(table, low, numBets, houseWinProb) <= target) return low;
+    while (high - low > 1) {
+        std::int64_t middle = low + (high - low) / 2;
+        if (closedFormRuinProbability(table, middle, numBets, houseWinProb) <= target) high = middle;
+        else low = middle;
+    }
+    return high;
+}
+
+/**
+ * @brief The answers of a bankroll search, every start in bet units.
+ */
+struct BankrollSearchResult {
+    double target = 0.0;
+    double confidence = 0.0;
+    std::int64_t exactUnits = 0;        // Smallest start whose exact ruin probability is at most target
+    double exactProbability = 0.0;      // ... and that probability
+    long long runs = 0;
+    std::int64_t estimateUnits = 0;     // Smallest start whose simulated ruin rate is at most target
+    long long estimateRuins = 0;
+    std::int64_t confidentUnits = -1;   // Smallest start shown to meet the target, or -1 if runs are too few
+    long long confidentRuins = 0;
+    double upperBound = 0.0;            // ... and the upper bound of its ruin probability
+};
+
+/**
+ * @brief Finds the smallest start meeting target, exactly and from the walks' depths (see
+ * simulateRuinDepths).
+ */
+inline BankrollSearchResult searchSmallestBankroll(const LogFactorialTable& table, long long numBets, double houseWinProb,
+    const RuinDepths& depths, double target, double confidence) {
+    BankrollSearchResult search;
+    search.target = target;
+    search.confidence = confidence;
+    search.exactUnits = exactSmallestStart(table, numBets, houseWinProb, target);
+    search.exactProbability = closedFormRuinProbability(table, search.exactUnits, numBets, houseWinProb);
+
+    search.runs = depths.runs;
+    search.estimateUnits = smallestStartAllowing(depths, static_cast<long long>(std::floor(target * search.runs)));
+    search.estimateRuins = ruinsFromDepths(depths, search.estimateUnits);
+
+    long long mostRuins = mostRuinsWithin(search.runs, target, confidence);
+    if (mostRuins >= 0) {
+        search.confidentUnits = smallestStartAllowing(depths, mostRuins);
+        search.confidentRuins = ruinsFromDepths(depths, search.confidentUnits);
+        search.upperBound = ruinUpperBound(search.confidentRuins, search.runs, confidence);
+    }
+    return search;
+}
+
+/**
+ * @brief Prints a bankroll search's answers, in dollars and bet units.
+ */
+inline void printBankrollSearch(const BankrollSearchResult& search, double betAmount) {
+    std::cout << "Smallest bankroll with a ruin probability of at most " << std::setprecision(4) << (search.target * 100.0) << "%:" << std::endl;
+    std::cout << std::setprecision(2);
+    std::cout << "  Exact:        $" << std::setw(14) << (search.exactUnits * betAmount) << " (" << search.exactUnits
+        << " units), ruin probability " << std::scientific << std::setprecision(4) << (search.exactProbability * 100.0)
+        << "%" << std::fixed << std::setprecision(2) << std::endl;
+    std::cout << "  Simulated:    $" << std::setw(14) << (search.estimateUnits * betAmount) << " (" << search.estimateUnits
+        << " units), " << search.estimateRuins << " of " << search.runs << " runs ruined" << std::endl;
+    std::cout << "  At " << std::setprecision(0) << (search.confidence * 100.0) << "% conf.: ";
+    if (search.confidentUnits >= 0) {
+        std::cout << "$" << std::setprecision(2) << std::setw(14) << (search.confidentUnits * betAmount) << " (" << search.confidentUnits
+            << " units), " << search.confidentRuins << " of " << search.runs << " runs ruined, upper bound "
+            << std::scientific << std::setprecision(4) << (search.upperBound * 100.0) << "%" << std::fixed << std::endl;
+    }
+    else {
+        // With no ruins at all the bound is about -ln(1 - c) / runs
+        std::cout << "not shown: " << search.runs << " runs cannot bound the ruin probability below the target (about "
+            << static_cast<long long>(std::ceil(-std::log(1.0 - search.confidence) / search.target)) << " are needed)" << std::endl;
+    }
+    std::cout << std::setprecision(5);
+}
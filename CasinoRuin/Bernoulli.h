@@ -0,0 +1,71 @@
+#pragma once
+
+#include <cmath>        // For ldexp and floor
+#include <cstdint>
+
+#include "Philox.h"
+
+/**
+ * @brief A win probability turned into an integer threshold, computed once per scenario.
+ *
+ * A bet is a uniform 64-bit integer U compared against T = floor(p * 2^64): the house
+ * wins when U < T, which happens with probability exactly T / 2^64. For any double
+ * p >= 2^-12, p * 2^64 is already an integer, so the draw is exact for the p we were
+ * given (e.g. the double nearest 5/9, which is within 2^-54 of 5/9 itself). Smaller p
+ * is truncated by less than 2^-64, and p >= 1 is treated as 1 - 2^-64.
+ *
+ * U is compared from the top: the high 32 bits (the bet's word in the run's stream)
+ * settle the bet unless they equal the threshold's high word, which happens once in
+ * 2^32 bets. Only then are the low 32 bits read, from the run's tie-break stream.
+ * So almost every bet costs one 32-bit compare on raw generator output.
+ */
+struct BernoulliThreshold {
+    std::uint32_t hi;
+    std::uint32_t lo;
+};
+
+/**
+ * @brief Precomputes the threshold for a win probability.
+ */
+inline BernoulliThreshold makeBernoulliThreshold(double probability) {
+    BernoulliThreshold threshold;
+    if (!(probability > 0.0)) {
+        threshold.hi = 0;
+        threshold.lo = 0;
+    }
+    else if (probability >= 1.0) {
+        threshold.hi = 0xFFFFFFFFu;
+        threshold.lo = 0xFFFFFFFFu;
+    }
+    else {
+        // Both steps are exact: scaling by 2^32 only changes the exponent,
+        // and the fractional part of a double is always representable.
+        double scaled = std::ldexp(probability, 32);
+        double hiPart = std::floor(scaled);
+        threshold.hi = static_cast<std::uint32_t>(hiPart);
+        threshold.lo = static_cast<std::uint32_t>(std::floor(std::ldexp(scaled - hiPart, 32)));
+    }
+    return threshold;
+}
+
+/**
+ * @brief The low 32 bits of bet betIndex's 64-bit draw, from the run's tie-break stream.
+ */
+inline std::uint32_t tieBreakWord(PhiloxKey streamKey, std::uint64_t runIndex, std::uint64_t betIndex) {
+    PhiloxStream tieBreak(streamKey, runIndex, STREAM_TIE_BREAK);
+    tieBreak.seek(betIndex);
+    return tieBreak();
+}
+
+/**
+ * @brief Decides one bet from the raw word the run's stream gave for it.
+ * @param word Word betIndex of the run's bet stream.
+ * @return true if the house wins the bet.
+ */
+inline bool houseWinsBet(const BernoulliThreshold& threshold, std::uint32_t word,
+    PhiloxKey streamKey, std::uint64_t runIndex, std::uint64_t betIndex) {
+    if (word != threshold.hi) {
+        return word < threshold.hi;
+    }
+    return tieBreakWord(streamKey, runIndex, betIndex) < threshold.lo;
+}
@@ -0,0 +1,323 @@
+#pragma once
+
+#include <cstdint>
+
+#include "CpuFeatures.h"
+#include "Lattice.h"
+#include "Philox.h"
+#include "Bernoulli.h"
+#include "LaneKernels.h" // For the vector Philox
+
+/*
+ * Block stepping: instead of moving the bankroll one bet at a time, a run decides
+ * 64 bets at once into a bit pattern (bit t = 1 when the house wins bet t) and then
+ * moves through the pattern a byte (8 bets) at a time.
+ *
+ * For a +1/-1 walk, 8 bets are fully described by two numbers: their net displacement
+ * and the lowest point the walk reaches inside them (the minimum prefix sum). Both are
+ * looked up in a 256-entry table built at compile time. A byte can only ruin the house
+ * if units + minPrefix drops below the ruin threshold, so the per-bet loop only runs for
+ * the one byte in which ruin actually happens (and for a partial final byte).
+ *
+ * The bets come from exactly the same Philox words and Bernoulli rule as every other
+ * engine, so results are bit-identical to the per-bet loop, not just in distribution.
+ */
+
+// Bets summarised by one table entry, and decided per pattern
+const int BETS_PER_TABLE_ENTRY = 8;
+const int BETS_PER_PATTERN = 64;
+
+/**
+ * @brief (net displacement, minimum prefix sum) of every 8-bet win/loss pattern.
+ */
+struct BlockStepTable {
+    std::int8_t net[256];
+    std::int8_t minPrefix[256];
+
+    constexpr BlockStepTable() : net(), minPrefix() {
+        for (int pattern = 0; pattern < 256; ++pattern) {
+            int position = 0;
+            int lowest = BETS_PER_TABLE_ENTRY;
+            for (int t = 0; t < BETS_PER_TABLE_ENTRY; ++t) {
+                position += ((pattern >> t) & 1) ? 1 : -1;
+                if (position < lowest) lowest = position;
+            }
+            net[pattern] = static_cast<std::int8_t>(position);
+            minPrefix[pattern] = static_cast<std::int8_t>(lowest);
+        }
+    }
+};
+
+/**
+ * @brief Moves bit b of an 8-bit mask to bit 4b. Vector kernels produce one mask per word
+ * position of a Philox block, and bet 4 * block + word has to land at that bit.
+ */
+struct SpreadEvery4Table {
+    std::uint32_t spread[256];
+
+    constexpr SpreadEvery4Table() : spread() {
+        for (int mask = 0; mask < 256; ++mask) {
+            std::uint32_t bits = 0;
+            for (int b = 0; b < 8; ++b) {
+                if ((mask >> b) & 1) bits |= 1u << (4 * b);
+            }
+            spread[mask] = bits;
+        }
+    }
+};
+
+inline const BlockStepTable& blockStepTable() {
+    static constexpr BlockStepTable table;
+    return table;
+}
+
+inline const SpreadEvery4Table& spreadEvery4Table() {
+    static constexpr SpreadEvery4Table table;
+    return table;
+}
+
+/**
+ * @brief Signature shared by the pattern generators: decides 64 consecutive bets of one run.
+ * @param firstBet The index of the first bet (a multiple of 64).
+ * @return Bit t set when the house wins bet firstBet + t.
+ */
+typedef std::uint64_t (*BetPatternGenerator)(PhiloxKey streamKey, std::uint64_t runIndex,
+    std::uint64_t firstBet, const BernoulliThreshold& houseWin);
+
+/**
+ * @brief Portable pattern generator: 16 scalar Philox blocks.
+ */
+inline std::uint64_t betPatternScalar(PhiloxKey streamKey, std::uint64_t runIndex,
+    std::uint64_t firstBet, const BernoulliThreshold& houseWin) {
+    std::uint32_t counter[4] = { 0, 0, static_cast<std::uint32_t>(runIndex), static_cast<std::uint32_t>(runIndex >> 32) };
+    std::uint32_t words[4];
+    std::uint64_t pattern = 0;
+
+    for (int b = 0; b < BETS_PER_PATTERN / 4; ++b) {
+        std::uint64_t block = firstBet / 4 + b;
+        counter[0] = static_cast<std::uint32_t>(block);
+        counter[1] = static_cast<std::uint32_t>(block >> 32);
+        philox4x32(counter, streamKey, words);
+        for (int j = 0; j < 4; ++j) {
+            std::uint64_t bet = 4 * b + j;
+            if (houseWinsBet(houseWin, words[j], streamKey, runIndex, firstBet + bet)) {
+                pattern |= 1ULL << bet;
+            }
+        }
+    }
+    return pattern;
+}
+
+#if CASINO_X86_SIMD
+
+/**
+ * @brief AVX2: 8 consecutive Philox blocks of one run in one go, i.e. 32 bets.
+ */
+CASINO_TARGET_AVX2 inline std::uint32_t betPattern32Avx2(PhiloxKey streamKey, std::uint64_t runIndex,
+    std::uint64_t firstBet, const BernoulliThreshold& houseWin) {
+    std::uint32_t blockLo[8], blockHi[8];
+    for (int b = 0; b < 8; ++b) {
+        std::uint64_t block = firstBet / 4 + b;
+        blockLo[b] = static_cast<std::uint32_t>(block);
+        blockHi[b] = static_cast<std::uint32_t>(block >> 32);
+    }
+    __m256i words[4] = {
+        _mm256_loadu_si256(reinterpret_cast<const __m256i*>(blockLo)),
+        _mm256_loadu_si256(reinterpret_cast<const __m256i*>(blockHi)),
+        _mm256_set1_epi32(static_cast<int>(static_cast<std::uint32_t>(runIndex))),
+        _mm256_set1_epi32(static_cast<int>(static_cast<std::uint32_t>(runIndex >> 32)))
+    };
+    philox4x32Avx2(words, streamKey);
+
+    // AVX2 only compares signed integers, so flip the sign bit on both sides
+    const __m256i signBit = _mm256_set1_epi32(static_cast<int>(0x80000000u));
+    const __m256i threshold = _mm256_set1_epi32(static_cast<int>(houseWin.hi ^ 0x80000000u));
+    const __m256i thresholdRaw = _mm256_set1_epi32(static_cast<int>(houseWin.hi));
+    const SpreadEvery4Table& spread = spreadEvery4Table();
+
+    std::uint32_t pattern = 0;
+    for (int j = 0; j < 4; ++j) {
+        __m256i win = _mm256_cmpgt_epi32(threshold, _mm256_xor_si256(words[j], signBit));
+        int mask = _mm256_movemask_ps(_mm256_castsi256_ps(win));
+
+        // A word equal to the threshold's high word needs its low word to decide (rare)
+        __m256i tied = _mm256_cmpeq_epi32(words[j], thresholdRaw);
+        int tiedMask = _mm256_movemask_ps(_mm256_castsi256_ps(tied));
+        for (int b = 0; tiedMask != 0; ++b, tiedMask >>= 1) {
+            if (tiedMask & 1) {
+                bool wins = tieBreakWord(streamKey, runIndex, firstBet + 4 * b + j) < houseWin.lo;
+                mask = wins ? (mask | (1 << b)) : (mask & ~(1 << b));
+            }
+        }
+
+        // Bit b of the mask is bet 4b + j
+        pattern |= spread.spread[mask] << j;
+    }
+    return pattern;
+}
+
+CASINO_TARGET_AVX2 inline std::uint64_t betPatternAvx2(PhiloxKey streamKey, std::uint64_t runIndex,
+    std::uint64_t firstBet, const BernoulliThreshold& houseWin) {
+    std::uint64_t low = betPattern32Avx2(streamKey, runIndex, firstBet, houseWin);
+    std::uint64_t high = betPattern32Avx2(streamKey, runIndex, firstBet + 32, houseWin);
+    return low | (high << 32);
+}
+
+/**
+ * @brief AVX-512: 16 consecutive Philox blocks of one run in one go, i.e. all 64 bets.
+ */
+CASINO_TARGET_AVX512 inline std::uint64_t betPatternAvx512(PhiloxKey streamKey, std::uint64_t runIndex,
+    std::uint64_t firstBet, const BernoulliThreshold& houseWin) {
+    std::uint32_t blockLo[16], blockHi[16];
+    for (int b = 0; b < 16; ++b) {
+        std::uint64_t block = firstBet / 4 + b;
+        blockLo[b] = static_cast<std::uint32_t>(block);
+        blockHi[b] = static_cast<std::uint32_t>(block >> 32);
+    }
+    __m512i words[4] = {
+        _mm512_loadu_si512(blockLo),
+        _mm512_loadu_si512(blockHi),
+        _mm512_set1_epi32(static_cast<int>(static_cast<std::uint32_t>(runIndex))),
+        _mm512_set1_epi32(static_cast<int>(static_cast<std::uint32_t>(runIndex >> 32)))
+    };
+    philox4x32Avx512(words, streamKey);
+
+    const __m512i threshold = _mm512_set1_epi32(static_cast<int>(houseWin.hi));
+    const SpreadEvery4Table& spread = spreadEvery4Table();
+
+    std::uint64_t pattern = 0;
+    for (int j = 0; j < 4; ++j) {
+        unsigned mask = _mm512_cmplt_epu32_mask(words[j], threshold);
+
+        // A word equal to the threshold's high word needs its low word to decide (rare)
+        unsigned tiedMask = _mm512_cmpeq_epu32_mask(words[j], threshold);
+        for (int b = 0; tiedMask != 0; ++b, tiedMask >>= 1) {
+            if (tiedMask & 1) {
+                bool wins = tieBreakWord(streamKey, runIndex, firstBet + 4 * b + j) < houseWin.lo;
+                mask = wins ? (mask | (1u << b)) : (mask & ~(1u << b));
+            }
+        }
+
+        // Bit b of the mask is bet 4b + j
+        std::uint64_t bits = spread.spread[mask & 0xFF] | (static_cast<std::uint64_t>(spread.spread[mask >> 8]) << 32);
+        pattern |= bits << j;
+    }
+    return pattern;
+}
+
+#endif // CASINO_X86_SIMD
+
+/**
+ * @brief Picks the pattern generator for a SIMD level. Levels the build cannot target fall back to scalar.
+ */
+inline BetPatternGenerator selectBetPatternGenerator(SimdLevel level) {
+#if CASINO_X86_SIMD
+    if (level == SimdLevel::Avx512) return betPatternAvx512;
+    if (level == SimdLevel::Avx2) return betPatternAvx2;
+#else
+    (void)level;
+#endif
+    return betPatternScalar;
+}
+
+/**
+ * @brief A mask of the first bets (0 to 64) of a pattern.
+ */
+inline std::uint64_t lowBetsMask(int bets) {
+    return (bets >= BETS_PER_PATTERN) ? ~0ULL : ((1ULL << bets) - 1);
+}
+
+/**
+ * @brief Simulates a single run on the integer lattice, 8 bets per table lookup.
+ * @param generate The pattern generator for this CPU (see selectBetPatternGenerator).
+ * @param streamKey The (master seed, scenario) key of the random streams.
+ * @param startUnits The starting bankroll in bet units (see makeLatticeScenario).
+ * @param numBets The total number of bets to simulate in this run.
+ * @param houseWin The house's win probability as a precomputed threshold (see makeBernoulliThreshold).
+ * @param runIndex The index of this run, which selects its own random stream.
+ * @param ruinBet If not null, receives the bet (1 to numBets) after which the house was
+ * ruined. Left untouched if it survived.
+ * @param path If not null, receives the run's bets, one bit per bet in ceil(numBets / 64)
+ * words (bit t of word w = 1 when the house won bet 64w + t). Bits past the last bet
+ * played are zero; words past it are not written.
+ * @return The final bankroll in bet units. Below RUIN_THRESHOLD_UNITS means the house was ruined.
+ */
+inline std::int64_t simulateBlockRun(BetPatternGenerator generate, PhiloxKey streamKey, std::int64_t startUnits,
+    long long numBets, const BernoulliThreshold& houseWin, long long runIndex, long long* ruinBet = nullptr, std::uint64_t* path = nullptr) {
+    const BlockStepTable& table = blockStepTable();
+    std::int64_t units = startUnits;
+
+    for (long long firstBet = 0; firstBet < numBets; firstBet += BETS_PER_PATTERN) {
+        std::uint64_t pattern = generate(streamKey, static_cast<std::uint64_t>(runIndex), static_cast<std::uint64_t>(firstBet), houseWin);
+        long long betsInPattern = numBets - firstBet;
+        if (betsInPattern > BETS_PER_PATTERN) betsInPattern = BETS_PER_PATTERN;
+        if (path) path[firstBet / BETS_PER_PATTERN] = pattern & lowBetsMask(static_cast<int>(betsInPattern));
+
+        for (int offset = 0; offset < betsInPattern; offset += BETS_PER_TABLE_ENTRY) {
+            unsigned bits = static_cast<unsigned>(pattern >> offset) & 0xFFu;
+
+            // Fast path: a whole byte that cannot reach the ruin threshold
+            if (betsInPattern - offset >= BETS_PER_TABLE_ENTRY && units + table.minPrefix[bits] >= RUIN_THRESHOLD_UNITS) {
+                units += table.net[bits];
+                continue;
+            }
+
+            // Slow path: step bet by bet through the byte where ruin happens (or the final partial byte)
+            long long betsInByte = betsInPattern - offset;
+            if (betsInByte > BETS_PER_TABLE_ENTRY) betsInByte = BETS_PER_TABLE_ENTRY;
+            for (int t = 0; t < betsInByte; ++t) {
+                units += ((bits >> t) & 1u) ? 1 : -1;
+                if (units < RUIN_THRESHOLD_UNITS) {
+                    if (ruinBet) *ruinBet = firstBet + offset + t + 1;
+                    if (path) path[firstBet / BETS_PER_PATTERN] &= lowBetsMask(offset + t + 1);
+                    return units;
+                }
+            }
+        }
+    }
+    return units;
+}
+
+/**
+ * @brief Carries a run on from bet fromBet to bet toBet with the block-stepping kernel:
+ * the same bets as continueLatticeRun, 8 per table lookup. The first pattern is shifted
+ * so stepping starts at fromBet, which need not be a multiple of 64.
+ * @param units The bankroll in bet units after bet fromBet.
+ * @param ruinBet If not null, receives the bet (fromBet + 1 to toBet) after which the
+ * house was ruined. Left untouched if it survived.
+ * @return The bankroll in bet units after bet toBet, or at ruin.
+ */
+inline std::int64_t continueBlockRun(BetPatternGenerator generate, PhiloxKey streamKey, std::int64_t units,
+    long long fromBet, long long toBet, const BernoulliThreshold& houseWin, long long runIndex, long long* ruinBet = nullptr) {
+    const BlockStepTable& table = blockStepTable();
+
+    for (long long patternStart = fromBet - fromBet % BETS_PER_PATTERN; patternStart < toBet; patternStart += BETS_PER_PATTERN) {
+        std::uint64_t pattern = generate(streamKey, static_cast<std::uint64_t>(runIndex), static_cast<std::uint64_t>(patternStart), houseWin);
+        long long firstBet = (patternStart < fromBet) ? fromBet : patternStart;
+        pattern >>= (firstBet - patternStart);
+        long long betsInPattern = toBet - firstBet;
+        if (betsInPattern > patternStart + BETS_PER_PATTERN - firstBet) betsInPattern = patternStart + BETS_PER_PATTERN - firstBet;
+
+        for (int offset = 0; offset < betsInPattern; offset += BETS_PER_TABLE_ENTRY) {
+            unsigned bits = static_cast<unsigned>(pattern >> offset) & 0xFFu;
+
+            // Fast path: a whole byte that cannot reach the ruin threshold
+            if (betsInPattern - offset >= BETS_PER_TABLE_ENTRY && units + table.minPrefix[bits] >= RUIN_THRESHOLD_UNITS) {
+                units += table.net[bits];
+                continue;
+            }
+
+            // Slow path: step bet by bet through the byte where ruin happens (or the final partial byte)
+            long long betsInByte = betsInPattern - offset;
+            if (betsInByte > BETS_PER_TABLE_ENTRY) betsInByte = BETS_PER_TABLE_ENTRY;
+            for (int t = 0; t < betsInByte; ++t) {
+                units += ((bits >> t) & 1u) ? 1 : -1;
+                if (units < RUIN_THRESHOLD_UNITS) {
+                    if (ruinBet) *ruinBet = firstBet + offset + t + 1;
+                    return units;
+                }
+            }
+        }
+    }
+    return units;
+}
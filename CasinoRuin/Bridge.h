@@ -0,0 +1,95 @@
+#pragma once
+
+#include <algorithm>    // For upper_bound
+#include <cmath>        // For exp, ldexp and log
+#include <cstdint>
+#include <vector>
+
+#include "Lattice.h"
+#include "Philox.h"
+#include "ClosedForm.h" // For LogFactorialTable and logBinomialPmf
+
+/*
+ * Bridge sampling: a whole run in O(log n) instead of n bets.
+ *
+ * With u wins out of n bets, the walk ends at x = 2u - n, and u is Binomial(n, p).
+ * Given its end point, every path to it is equally likely (each has probability
+ * p^u q^(n-u)), so by the reflection principle (see ClosedForm.h) a walk that started
+ * d units above ruin and ends at x has been ruined
+ *   - certainly, if x <= -d, and
+ *   - otherwise with probability C(n, u + d) / C(n, u).
+ * So a run is one draw of u, by binary search in a precomputed CDF table, and one
+ * Bernoulli draw for ruin. The outcome has exactly the distribution of a stepped run
+ * (up to the 2^-53 resolution of the uniforms), but it is not the same outcome a stepped
+ * engine gives for the same run index: it reads its own sub-stream.
+ */
+
+/**
+ * @brief Samples the final bankroll of whole runs of a fixed length and win probability.
+ */
+class BridgeSampler {
+public:
+    BridgeSampler() : numBets(0), logMirrorPerUnit(0.0), winProbability(0.0), table(nullptr) {}
+
+    /**
+     * @param logFactorials Log-factorials up to at least numBets; must outlive the sampler.
+     * @param numBets The number of bets in a run.
+     * @param houseWinProb The probability (0.0 to 1.0) that the house wins a single bet.
+     */
+    BridgeSampler(const LogFactorialTable& logFactorials, long long numBets, double houseWinProb)
+        : numBets(numBets), logMirrorPerUnit(std::log1p(-houseWinProb) - std::log(houseWinProb)),
+          winProbability(houseWinProb), table(&logFactorials), cdf(static_cast<std::size_t>(numBets + 1)) {
+        double cumulative = 0.0;
+        for (long long ups = 0; ups <= numBets; ++ups) {
+            cumulative += std::exp(logBinomialPmf(logFactorials, numBets, ups, houseWinProb));
+            cdf[static_cast<std::size_t>(ups)] = cumulative;
+        }
+    }
+
+    /**
+     * @brief Samples one run.
+     * @param streamKey The (master seed, scenario) key of the random streams.
+     * @param startUnits The starting bankroll in bet units; at least RUIN_THRESHOLD_UNITS.
+     * @param runIndex The index of this run, which selects its own random stream.
+     * @return The final bankroll in bet units. Below RUIN_THRESHOLD_UNITS means the house was ruined.
+     */
+    std::int64_t sample(PhiloxKey streamKey, std::int64_t startUnits, long long runIndex) const {
+        PhiloxStream generator(streamKey, static_cast<std::uint64_t>(runIndex), STREAM_BRIDGE);
+
+        // The number of wins, by inverse CDF (scaled by the total so rounding never runs off the end)
+        double uniform = uniform53(generator) * cdf.back();
+        long long ups = static_cast<long long>(std::upper_bound(cdf.begin(), cdf.end(), uniform) - cdf.begin());
+        if (ups > numBets) ups = numBets;
+        std::int64_t endUnits = startUnits + (2 * ups - numBets);
+
+        if (endUnits < RUIN_THRESHOLD_UNITS) {
+            return RUIN_THRESHOLD_UNITS - 1;
+        }
+
+        // C(n, u + d) / C(n, u) = b(u + d) / b(u) * (q/p)^d, with d the distance to ruin
+        std::int64_t distance = startUnits - RUIN_THRESHOLD_UNITS + 1;
+        double logHit = logBinomialPmf(*table, numBets, ups + distance, winProbability)
+            - logBinomialPmf(*table, numBets, ups, winProbability)
+            + static_cast<double>(distance) * logMirrorPerUnit;
+        if (uniform53(generator) < std::exp(logHit)) {
+            return RUIN_THRESHOLD_UNITS - 1;
+        }
+        return endUnits;
+    }
+
+private:
+    /**
+     * @brief A uniform double in [0, 1) with 53 random bits, from two words of the stream.
+     */
+    static double uniform53(PhiloxStream& generator) {
+        std::uint64_t high = generator();
+        std::uint64_t low = generator();
+        return std::ldexp(static_cast<double>(((high << 32) | low) >> 11), -53);
+    }
+
+    long long numBets;
+    double logMirrorPerUnit;      // log(q / p)
+    double winProbability;
+    const LogFactorialTable* table;
+    std::vector<double> cdf;      // cdf[u] = P(at most u wins)
+};
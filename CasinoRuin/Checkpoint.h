@@ -0,0 +1,386 @@
+#pragma once
+
+#include <csignal>      // For signal and sig_atomic_t
+#include <cstdint>
+#include <cstdio>       // For rename and remove
+#include <cstring>      // For memcpy and memcmp
+#include <fstream>
+#include <iterator>     // For istreambuf_iterator
+#include <string>
+#include <utility>      // For move
+#include <vector>
+
+#include "Engine.h"     // For SimulationEngine and EvaluationMode
+#include "FirstPassage.h" // For PassageHistogram
+#include "Histogram.h"  // For LatticeHistogram and HistogramBins
+#include "Results.h"    // For ScenarioResult
+#include "Statistics.h" // For BankrollStatistics
+
+/*
+ * Checkpoints: everything needed to carry on with a sweep, in one small binary file.
+ *
+ * No generator state has to be saved: run i of a bankroll always draws from its own
+ * counter-based stream (see Philox.h), so where the streams had got to is just the number
+ * of runs done. What is saved is what those runs added up to: for every bankroll started,
+ * its runs done, the stopping rule's looks and every accumulator, merged over the threads,
+ * and for the finished ones the results printed for them.
+ *
+ * Checkpoints are taken only between segments of whole chunks, when nothing is half-merged:
+ * the histograms and counters are integers, whose merge order does not matter, and the
+ * statistics have merged exactly the chunks before runsDone, in run order. So a resumed
+ * sweep goes on from the very state the uninterrupted one had and prints the same numbers.
+ *
+ * The checkpoint left by a finished sweep is kept, and a bigger run budget (--extend)
+ * reopens every bankroll in it: runs runsDone and up draw from streams no run has used,
+ * and fold into the same accumulators. Without a precision target, counts, histograms and
+ * passage times come out exactly as one sweep of the bigger budget would give them. Where
+ * the old budget cut a chunk short, the moments can differ in the last digits and the
+ * sketch's quantiles within its accuracy, as the chunks are merged differently. With a
+ * target, bankrolls that met it stay as they are and the rest carry on with their looks.
+ *
+ * File layout: the magic "CRCHKPT\0", then every value as 8 little-endian bytes, in the
+ * order CheckpointState::save writes them. A checkpoint is written to a temporary file
+ * that is then renamed over the old one, so a crash mid-write never leaves a torn file.
+ */
+
+const char CHECKPOINT_FILE_MAGIC[8] = { 'C', 'R', 'C', 'H', 'K', 'P', 'T', '\0' };
+const std::int64_t CHECKPOINT_FILE_VERSION = 2;
+
+// A bankroll is simulated in segments of this many chunks when checkpointing, so there is
+// a chance to save (or to act on a signal) every few seconds even within one bankroll
+const long long CHECKPOINT_SEGMENT_CHUNKS = 64;
+
+/**
+ * @brief Serializes a checkpoint into memory, as 8-byte little-endian values.
+ */
+class CheckpointWriter {
+public:
+    CheckpointWriter() : bytes(CHECKPOINT_FILE_MAGIC, CHECKPOINT_FILE_MAGIC + 8) {}
+
+    void putWord(std::uint64_t value) {
+        for (int i = 0; i < 8; ++i) {
+            bytes.push_back(static_cast<unsigned char>(value >> (8 * i)));
+        }
+    }
+
+    void putInt(std::int64_t value) { putWord(static_cast<std::uint64_t>(value)); }
+
+    void putDouble(double value) {
+        std::uint64_t bits;
+        std::memcpy(&bits, &value, sizeof(bits));
+        putWord(bits);
+    }
+
+    const std::vector<unsigned char>& data() const { return bytes; }
+
+private:
+    std::vector<unsigned char> bytes;
+};
+
+/**
+ * @brief Reads back what CheckpointWriter wrote. Reading past the end gives zeros and
+ * marks the reader failed, so a truncated file is caught by one ok() at the end.
+ */
+class CheckpointReader {
+public:
+    explicit CheckpointReader(std::vector<unsigned char> data) : bytes(std::move(data)), position(8), failed(false) {
+        if (bytes.size() < 8 || std::memcmp(bytes.data(), CHECKPOINT_FILE_MAGIC, 8) != 0) failed = true;
+    }
+
+    std::uint64_t getWord() {
+        if (failed || bytes.size() - position < 8) {
+            failed = true;
+            return 0;
+        }
+        std::uint64_t value = 0;
+        for (int i = 0; i < 8; ++i) {
+            value |= static_cast<std::uint64_t>(bytes[position + i]) << (8 * i);
+        }
+        position += 8;
+        return value;
+    }
+
+    std::int64_t getInt() { return static_cast<std::int64_t>(getWord()); }
+
+    double getDouble() {
+        std::uint64_t bits = getWord();
+        double value;
+        std::memcpy(&value, &bits, sizeof(value));
+        return value;
+    }
+
+    /**
+     * @brief Reads the length of a list, rejecting one longer than the rest of the file,
+     * so a corrupt length never turns into a huge allocation.
+     */
+    std::size_t getCount() {
+        std::int64_t count = getInt();
+        if (count < 0 || static_cast<std::uint64_t>(count) > (bytes.size() - position) / 8) {
+            failed = true;
+            return 0;
+        }
+        return static_cast<std::size_t>(count);
+    }
+
+    bool ok() const { return !failed; }
+    bool atEnd() const { return position == bytes.size(); }
+
+private:
+    std::vector<unsigned char> bytes;
+    std::size_t position;
+    bool failed;
+};
+
+inline void saveHistogramBins(CheckpointWriter& out, const HistogramBins& bins) {
+    out.putDouble(bins.minBankroll);
+    out.putDouble(bins.maxBankroll);
+    out.putDouble(bins.binWidth);
+    out.putDouble(bins.totalWeight);
+    out.putDouble(bins.maxBinWeight);
+    out.putInt(static_cast<std::int64_t>(bins.weights.size()));
+    for (double weight : bins.weights) out.putDouble(weight);
+}
+
+inline void loadHistogramBins(CheckpointReader& in, HistogramBins& bins) {
+    bins.minBankroll = in.getDouble();
+    bins.maxBankroll = in.getDouble();
+    bins.binWidth = in.getDouble();
+    bins.totalWeight = in.getDouble();
+    bins.maxBinWeight = in.getDouble();
+    bins.weights.assign(in.getCount(), 0.0);
+    for (double& weight : bins.weights) weight = in.getDouble();
+}
+
+inline void saveScenarioResult(CheckpointWriter& out, const ScenarioResult& result) {
+    out.putInt(static_cast<std::int64_t>(result.mode));
+    out.putDouble(result.startBankroll);
+    out.putDouble(result.betAmount);
+    out.putDouble(result.houseWinProb);
+    out.putInt(result.betsPerRun);
+    out.putInt(result.totalRuns);
+    out.putInt(result.ruinCount);
+    out.putDouble(result.ruinProbability);
+    out.putDouble(result.interval.low);
+    out.putDouble(result.interval.high);
+    out.putDouble(result.relativeError);
+    out.putDouble(result.elapsedSeconds);
+    out.putInt(result.adaptive ? 1 : 0);
+    out.putInt(result.targetMet ? 1 : 0);
+    saveHistogramBins(out, result.histogram);
+}
+
+inline void loadScenarioResult(CheckpointReader& in, ScenarioResult& result) {
+    result.mode = static_cast<EvaluationMode>(in.getInt());
+    result.startBankroll = in.getDouble();
+    result.betAmount = in.getDouble();
+    result.houseWinProb = in.getDouble();
+    result.betsPerRun = in.getInt();
+    result.totalRuns = in.getInt();
+    result.ruinCount = in.getInt();
+    result.ruinProbability = in.getDouble();
+    result.interval.low = in.getDouble();
+    result.interval.high = in.getDouble();
+    result.relativeError = in.getDouble();
+    result.elapsedSeconds = in.getDouble();
+    result.adaptive = in.getInt() != 0;
+    result.targetMet = in.getInt() != 0;
+    loadHistogramBins(in, result.histogram);
+}
+
+/**
+ * @brief Everything simulated so far for one bankroll: its accumulators, merged over the
+ * threads, and once it is complete, the result printed for it.
+ */
+struct SavedScenario {
+    long long runsDone = 0;         // Runs 0 to runsDone - 1 are simulated
+    long long lookEnd = 0;          // The runs done at the stopping rule's next look
+    int look = 0;                   // Looks taken so far
+    double elapsedSeconds = 0.0;    // Wall time spent on it so far
+    long long ruinCount = 0;        // Ruined runs
+    LatticeHistogram histogram;     // The final bankrolls, where the program keeps them
+    BankrollStatistics statistics;  // ... and their moments and quantiles
+    PassageHistogram passage;       // Empty unless first-passage times are recorded
+    bool complete = false;          // Simulated to the end of its budget, or to its target
+    ScenarioResult result;          // Once complete
+
+    /**
+     * @brief True if there is nothing left to simulate under a run budget. A bankroll
+     * completed under a smaller budget is reopened, unless it met its precision target.
+     */
+    bool doneWithin(long long runBudget) const {
+        return complete && (result.targetMet || runsDone >= runBudget);
+    }
+
+    void save(CheckpointWriter& out) const {
+        out.putInt(runsDone);
+        out.putInt(lookEnd);
+        out.putInt(look);
+        out.putDouble(elapsedSeconds);
+        out.putInt(ruinCount);
+        histogram.save(out);
+        statistics.save(out);
+        passage.save(out);
+        out.putInt(complete ? 1 : 0);
+        saveScenarioResult(out, result);
+    }
+
+    bool load(CheckpointReader& in) {
+        runsDone = in.getInt();
+        lookEnd = in.getInt();
+        look = static_cast<int>(in.getInt());
+        elapsedSeconds = in.getDouble();
+        ruinCount = in.getInt();
+        if (!histogram.load(in) || !statistics.load(in) || !passage.load(in)) return false;
+        complete = in.getInt() != 0;
+        loadScenarioResult(in, result);
+        return in.ok();
+    }
+};
+
+/**
+ * @brief The state of a sweep between two segments of runs, or at its end.
+ */
+struct CheckpointState {
+    // The sweep's settings: a checkpoint only resumes the sweep that wrote it
+    std::uint64_t masterSeed = 0;
+    EvaluationMode mode = EvaluationMode::MonteCarlo;
+    SimulationEngine engine = SimulationEngine::Lanes;
+    long long betsPerRun = 0;
+    double houseWinProb = 0.0;
+    double betAmount = 0.0;
+    double targetAbsolute = 0.0;
+    double targetRelative = 0.0;
+    std::vector<double> bankrolls;
+
+    // Runs per bankroll. Not a setting that has to match: --extend raises it.
+    long long runBudget = 0;
+
+    // The bankrolls started so far, in sweep order; only the last can be part way through
+    std::vector<SavedScenario> scenarios;
+
+    bool sameSettings(const CheckpointState& other) const {
+        return masterSeed == other.masterSeed && mode == other.mode && engine == other.engine
+            && betsPerRun == other.betsPerRun
+            && houseWinProb == other.houseWinProb && betAmount == other.betAmount
+            && targetAbsolute == other.targetAbsolute && targetRelative == other.targetRelative
+            && bankrolls == other.bankrolls;
+    }
+
+    /**
+     * @brief The number of bankrolls with nothing left to simulate.
+     */
+    std::size_t scenariosDone() const {
+        std::size_t done = 0;
+        for (const SavedScenario& scenario : scenarios) {
+            if (scenario.doneWithin(runBudget)) ++done;
+        }
+        return done;
+    }
+
+    void save(CheckpointWriter& out) const {
+        out.putInt(CHECKPOINT_FILE_VERSION);
+        out.putWord(masterSeed);
+        out.putInt(static_cast<std::int64_t>(mode));
+        out.putInt(static_cast<std::int64_t>(engine));
+        out.putInt(betsPerRun);
+        out.putDouble(houseWinProb);
+        out.putDouble(betAmount);
+        out.putDouble(targetAbsolute);
+        out.putDouble(targetRelative);
+        out.putInt(static_cast<std::int64_t>(bankrolls.size()));
+        for (double bankroll : bankrolls) out.putDouble(bankroll);
+        out.putInt(runBudget);
+
+        out.putInt(static_cast<std::int64_t>(scenarios.size()));
+        for (const SavedScenario& scenario : scenarios) {
+            scenario.save(out);
+        }
+    }
+
+    /**
+     * @return false if the checkpoint is of another version, cut short or corrupt.
+     */
+    bool load(CheckpointReader& in) {
+        if (in.getInt() != CHECKPOINT_FILE_VERSION) return false;
+        masterSeed = in.getWord();
+        mode = static_cast<EvaluationMode>(in.getInt());
+        engine = static_cast<SimulationEngine>(in.getInt());
+        betsPerRun = in.getInt();
+        houseWinProb = in.getDouble();
+        betAmount = in.getDouble();
+        targetAbsolute = in.getDouble();
+        targetRelative = in.getDouble();
+        bankrolls.assign(in.getCount(), 0.0);
+        for (double& bankroll : bankrolls) bankroll = in.getDouble();
+        runBudget = in.getInt();
+
+        scenarios.assign(in.getCount(), SavedScenario());
+        for (SavedScenario& scenario : scenarios) {
+            if (!scenario.load(in)) return false;
+        }
+        return in.ok() && in.atEnd() && scenarios.size() <= bankrolls.size();
+    }
+};
+
+/**
+ * @brief Writes a checkpoint, replacing any earlier one only once it is complete.
+ * @return false if the file could not be written.
+ */
+inline bool writeCheckpoint(const std::string& path, const CheckpointState& state) {
+    CheckpointWriter out;
+    state.save(out);
+
+    const std::string temporaryPath = path + ".tmp";
+    {
+        std::ofstream file(temporaryPath.c_str(), std::ios::binary | std::ios::trunc);
+        file.write(reinterpret_cast<const char*>(out.data().data()), static_cast<std::streamsize>(out.data().size()));
+        file.flush();
+        if (!file) return false;
+    }
+#if defined(_WIN32)
+    // (rename does not replace an existing file on Windows)
+    std::remove(path.c_str());
+#endif
+    return std::rename(temporaryPath.c_str(), path.c_str()) == 0;
+}
+
+/**
+ * @return false if the file is missing, or is not a complete checkpoint.
+ */
+inline bool readCheckpoint(const std::string& path, CheckpointState& state) {
+    std::ifstream file(path.c_str(), std::ios::binary);
+    if (!file) return false;
+    std::vector<unsigned char> bytes((std::istreambuf_iterator<char>(file)), std::istreambuf_iterator<char>());
+    CheckpointReader in(std::move(bytes));
+    return in.ok() && state.load(in);
+}
+
+/*
+ * SIGINT and SIGTERM only raise a flag. The simulation loop notices it at the end of the
+ * segment in progress, writes a checkpoint and exits; writing files from the handler
+ * itself would not be safe. The handler then restores the default action, so a second
+ * signal stops the program at once.
+ */
+
+inline volatile std::sig_atomic_t& checkpointSignalFlag() {
+    static volatile std::sig_atomic_t received = 0;
+    return received;
+}
+
+extern "C" inline void onCheckpointSignal(int signalNumber) {
+    checkpointSignalFlag() = 1;
+    std::signal(signalNumber, SIG_DFL);
+}
+
+inline void installCheckpointSignalHandlers() {
+    checkpointSignalFlag() = 0;
+    std::signal(SIGINT, onCheckpointSignal);
+    std::signal(SIGTERM, onCheckpointSignal);
+}
+
+/**
+ * @brief True once SIGINT or SIGTERM has asked for a checkpoint and an exit.
+ */
+inline bool checkpointSignalled() {
+    return checkpointSignalFlag() != 0;
+}
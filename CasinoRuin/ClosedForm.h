@@ -0,0 +1,192 @@
+#pragma once
+
+#include <cmath>        // For lgamma, exp, expm1, log and log1p
+#include <cstdint>
+#include <limits>
+#include <vector>
+
+#include "Lattice.h"
+#include "ExactSolver.h" // For ExactDistribution
+
+/*
+ * Closed-form evaluation of the fixed-bet game by the reflection principle.
+ *
+ * Let the walk start d >= 1 units above ruin and take n +1/-1 steps, +1 with
+ * probability p. A path with u up-steps ends at x = 2u - n. A path ending at x <= -d
+ * has certainly been ruined. A path ending at x > -d that touched -d on the way is
+ * mirrored at its first touch into a path ending at -2d - x, one-to-one, so there are
+ * C(n, u + d) of them, each with probability p^u q^(n-u) = b(u + d) * (q/p)^d / C(n, u + d),
+ * where b(k) = C(n, k) p^k q^(n-k) is the binomial pmf. Hence
+ *
+ *   P(ruin)              = sum_{x <= -d} b(u) + (q/p)^d * sum_{x > -d} b(u + d)
+ *   P(survive, end at x) = b(u) - (q/p)^d * b(u + d)                 for x > -d
+ *
+ * Every b(k) is formed in log space from a precomputed log-factorial table, so a query
+ * is O(n) with no sampling and no overflow, however long the run is.
+ */
+
+// log(2 pi), spelled out because M_PI is not standard C++
+const double LOG_TWO_PI = 1.8378770664093454836;
+
+/**
+ * @brief log(k!) for k = 0..maxN, built once and shared by every query up to maxN bets.
+ *
+ * log(k!) itself is around 1.3e7 at k = 1e6, where a double only resolves about 2e-9,
+ * and log C(n, k) is the difference of three such numbers. So the table stores only the
+ * remainder of Stirling's formula,
+ *   log(k!) = (k + 1/2) log(k) - k + log(2 pi) / 2 + remainder(k),
+ * which is small and keeps full precision; the large terms are combined analytically in
+ * logBinomialPmf (Loader's saddle-point form), which is accurate to ~1e-15 relative.
+ */
+class LogFactorialTable {
+public:
+    explicit LogFactorialTable(long long maxN) : remainder(static_cast<std::size_t>(maxN + 1)) {
+        remainder[0] = 0.0;
+        for (long long k = 1; k <= maxN; ++k) {
+            double x = static_cast<double>(k);
+            if (k <= 15) {
+                remainder[static_cast<std::size_t>(k)] = std::lgamma(x + 1.0) - (x + 0.5) * std::log(x) + x - 0.5 * LOG_TWO_PI;
+            }
+            else {
+                // Stirling series: 1/12k - 1/360k^3 + 1/1260k^5 - 1/1680k^7 + 1/1188k^9
+                double xx = x * x;
+                remainder[static_cast<std::size_t>(k)] =
+                    (1.0 / 12 - (1.0 / 360 - (1.0 / 1260 - (1.0 / 1680 - (1.0 / 1188) / xx) / xx) / xx) / xx) / x;
+            }
+        }
+    }
+
+    long long maxN() const { return static_cast<long long>(remainder.size()) - 1; }
+
+    /**
+     * @brief log(k!) minus its Stirling approximation.
+     */
+    double stirlingRemainder(long long k) const { return remainder[static_cast<std::size_t>(k)]; }
+
+private:
+    std::vector<double> remainder;
+};
+
+/**
+ * @brief x log(x / mean) + mean - x, without the cancellation of the direct formula when x is near mean.
+ */
+inline double binomialDeviance(double x, double mean) {
+    if (std::fabs(x - mean) < 0.1 * (x + mean)) {
+        double v = (x - mean) / (x + mean);
+        double sum = (x - mean) * v;
+        double term = 2.0 * x * v;
+        v = v * v;
+        for (int j = 1; j < 1000; ++j) {
+            term *= v;
+            double next = sum + term / (2 * j + 1);
+            if (next == sum) break;
+            sum = next;
+        }
+        return sum;
+    }
+    return x * std::log(x / mean) + mean - x;
+}
+
+/**
+ * @brief log(C(n, k) p^k (1 - p)^(n - k)); minus infinity when the probability is zero.
+ */
+inline double logBinomialPmf(const LogFactorialTable& table, long long n, long long k, double p) {
+    const double minusInfinity = -std::numeric_limits<double>::infinity();
+    const double q = 1.0 - p;
+    if (k < 0 || k > n) return minusInfinity;
+
+    // The end points need no factorials (and cover p = 0 and p = 1)
+    if (k == 0) return (n == 0) ? 0.0 : ((q > 0.0) ? static_cast<double>(n) * std::log(q) : minusInfinity);
+    if (k == n) return (p > 0.0) ? static_cast<double>(n) * std::log(p) : minusInfinity;
+    if (p <= 0.0 || q <= 0.0) return minusInfinity;
+
+    const double nn = static_cast<double>(n);
+    const double kk = static_cast<double>(k);
+    double logCore = table.stirlingRemainder(n) - table.stirlingRemainder(k) - table.stirlingRemainder(n - k)
+        - binomialDeviance(kk, nn * p) - binomialDeviance(nn - kk, nn * q);
+    return logCore - 0.5 * (LOG_TWO_PI + std::log(kk) + std::log1p(-kk / nn));
+}
+
+/**
+ * @brief The ruin probability of a walk that starts distance units above ruin (distance >= 1).
+ */
+inline double reflectionRuinProbability(const LogFactorialTable& table, std::int64_t distance, long long numBets, double houseWinProb) {
+    const long long n = numBets;
+    const double logMirror = static_cast<double>(distance) * (std::log1p(-houseWinProb) - std::log(houseWinProb));
+
+    // Both sums vanish once ups + distance > n: the walk cannot get that far down
+    double ruinProbability = 0.0;
+    for (long long ups = 0; ups + distance <= n; ++ups) {
+        long long endpoint = 2 * ups - n;
+        if (endpoint <= -distance) {
+            ruinProbability += std::exp(logBinomialPmf(table, n, ups, houseWinProb));
+        }
+        else {
+            ruinProbability += std::exp(logBinomialPmf(table, n, ups + distance, houseWinProb) + logMirror);
+        }
+    }
+    return ruinProbability;
+}
+
+/**
+ * @brief The exact ruin probability of a run, in closed form.
+ * @param table Log-factorials up to at least numBets.
+ * @param startUnits The starting bankroll in bet units (see makeLatticeScenario).
+ * @param numBets The number of bets in a run.
+ * @param houseWinProb The probability (0.0 to 1.0) that the house wins a single bet.
+ */
+inline double closedFormRuinProbability(const LogFactorialTable& table, std::int64_t startUnits, long long numBets, double houseWinProb) {
+    std::int64_t distance = startUnits - RUIN_THRESHOLD_UNITS + 1;
+    if (distance >= 1) {
+        return reflectionRuinProbability(table, distance, numBets, houseWinProb);
+    }
+
+    // A start below one bet still plays its first bet, like the simulation
+    if (numBets == 0 || distance < 0) return 1.0;
+    return (1.0 - houseWinProb) + houseWinProb * reflectionRuinProbability(table, 1, numBets - 1, houseWinProb);
+}
+
+/**
+ * @brief The exact ruin probability and surviving-bankroll distribution of a run, in closed form.
+ * Gives the same result as solveFiniteHorizon in O(numBets) instead of O(numBets * band width).
+ */
+inline ExactDistribution closedFormDistribution(const LogFactorialTable& table, std::int64_t startUnits, long long numBets, double houseWinProb) {
+    ExactDistribution result;
+    double scale = 1.0;
+
+    // A start below one bet still plays its first bet, like the simulation
+    if (startUnits < RUIN_THRESHOLD_UNITS) {
+        if (numBets == 0 || startUnits + 1 < RUIN_THRESHOLD_UNITS) {
+            result.ruinProbability = 1.0;
+            return result;
+        }
+        result.ruinProbability = 1.0 - houseWinProb;
+        scale = houseWinProb;
+        startUnits += 1;
+        numBets -= 1;
+    }
+
+    const std::int64_t distance = startUnits - RUIN_THRESHOLD_UNITS + 1;
+    const long long n = numBets;
+    const double logMirror = static_cast<double>(distance) * (std::log1p(-houseWinProb) - std::log(houseWinProb));
+
+    result.ruinProbability += scale * reflectionRuinProbability(table, distance, n, houseWinProb);
+
+    // Surviving endpoints x > -distance, i.e. ups > (n - distance) / 2
+    const long long lowestUps = (n - distance >= 0) ? (n - distance) / 2 + 1 : 0;
+    if (lowestUps > n) return result;
+
+    result.lowestUnits = startUnits + (2 * lowestUps - n);
+    result.survivingProbability.assign(static_cast<std::size_t>(2 * (n - lowestUps) + 1), 0.0);
+    for (long long ups = lowestUps; ups <= n; ++ups) {
+        double logAll = logBinomialPmf(table, n, ups, houseWinProb);
+        if (logAll == -std::numeric_limits<double>::infinity()) continue;
+
+        // b(u) - (q/p)^d b(u + d) = b(u) * (1 - (q/p)^d b(u + d) / b(u)), without cancellation
+        double logRatio = logBinomialPmf(table, n, ups + distance, houseWinProb) + logMirror - logAll;
+        double survivingFraction = -std::expm1(logRatio);
+
+        result.survivingProbability[static_cast<std::size_t>(2 * (ups - lowestUps))] = scale * std::exp(logAll) * survivingFraction;
+    }
+    return result;
+}
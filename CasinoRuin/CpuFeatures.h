@@ -0,0 +1,80 @@
+#pragma once
+
+#include <cstdint>
+
+// --- Instruction Set Support ---
+// The lane-parallel kernels are compiled for every instruction set in the same
+// binary and picked at runtime, so one build runs on any x86-64 machine.
+#if defined(__x86_64__) || defined(_M_X64) || defined(__i386__) || defined(_M_IX86)
+#define CASINO_X86_SIMD 1
+#include <immintrin.h>
+#if defined(_MSC_VER)
+#include <intrin.h>
+#endif
+#else
+#define CASINO_X86_SIMD 0
+#endif
+
+// MSVC lets any function use any intrinsic; GCC and Clang need the target per function.
+#if CASINO_X86_SIMD && !defined(_MSC_VER)
+#define CASINO_TARGET_AVX2 __attribute__((target("avx2")))
+#define CASINO_TARGET_AVX512 __attribute__((target("avx512f")))
+#else
+#define CASINO_TARGET_AVX2
+#define CASINO_TARGET_AVX512
+#endif
+
+/**
+ * @brief The widest vector instruction set a kernel may use on this machine.
+ */
+enum class SimdLevel {
+    Scalar,
+    Avx2,
+    Avx512
+};
+
+/**
+ * @brief Asks the CPU (and OS) which vector instruction sets are usable.
+ * @return The widest supported level, or SimdLevel::Scalar on non-x86 machines.
+ */
+inline SimdLevel detectSimdLevel() {
+#if CASINO_X86_SIMD && defined(_MSC_VER)
+    int info[4];
+    __cpuid(info, 0);
+    int maxLeaf = info[0];
+    if (maxLeaf < 7) return SimdLevel::Scalar;
+
+    __cpuid(info, 1);
+    bool osSavesYmm = (info[2] & (1 << 27)) != 0; // OSXSAVE
+    if (!osSavesYmm) return SimdLevel::Scalar;
+    unsigned long long xcr0 = _xgetbv(0);
+    bool ymmEnabled = (xcr0 & 0x6) == 0x6;
+    bool zmmEnabled = (xcr0 & 0xE6) == 0xE6;
+
+    __cpuidex(info, 7, 0);
+    bool hasAvx2 = (info[1] & (1 << 5)) != 0;
+    bool hasAvx512f = (info[1] & (1 << 16)) != 0;
+
+    if (hasAvx512f && zmmEnabled) return SimdLevel::Avx512;
+    if (hasAvx2 && ymmEnabled) return SimdLevel::Avx2;
+    return SimdLevel::Scalar;
+#elif CASINO_X86_SIMD
+    __builtin_cpu_init();
+    if (__builtin_cpu_supports("avx512f")) return SimdLevel::Avx512;
+    if (__builtin_cpu_supports("avx2")) return SimdLevel::Avx2;
+    return SimdLevel::Scalar;
+#else
+    return SimdLevel::Scalar;
+#endif
+}
+
+/**
+ * @brief A printable name for a SIMD level, used in the simulation header.
+ */
+inline const char* simdLevelName(SimdLevel level) {
+    switch (level) {
+    case SimdLevel::Avx512: return "AVX-512";
+    case SimdLevel::Avx2: return "AVX2";
+    default: return "Scalar";
+    }
+}
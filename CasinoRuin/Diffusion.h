@@ -0,0 +1,131 @@
+#pragma once
+
+#include <cmath>        // For erfc, exp, log and sqrt
+#include <cstdint>
+#include <vector>
+
+#include "Lattice.h"
+#include "ClosedForm.h" // For calibrating against closedFormRuinProbability
+
+/*
+ * The diffusion approximation: the walk as a Brownian motion with drift mu and variance
+ * sigma^2 per bet, started x units above ruin. Its probability of reaching ruin within
+ * T bets is the inverse-Gaussian first-passage probability
+ *     Phi((-x - mu T) / (sigma sqrt(T))) + exp(-2 mu x / sigma^2) Phi((-x + mu T) / (sigma sqrt(T))),
+ * a handful of erfc calls whatever the bankroll or horizon.
+ *
+ * Continuity correction. A walk with +-1 steps is ruined from s units when it reaches
+ * displacement -s, and by the reflection principle P(min <= -s) = P(S <= -s) + P(S <= -s - 2)
+ * (at the level the walk's parity allows). Each term's lattice correction moves its bound
+ * one unit, towards and away from ruin, so the pair matches a barrier at exactly -s:
+ * x = s. The naive continuous barrier at RUIN_THRESHOLD_UNITS, or a half-unit shift
+ * between it and the next level, is off by one over sqrt(n) and worse (on the calibration
+ * grid: 1.6e-3 instead of 1.6e-6 at a million fair bets).
+ *
+ * Drift and variance. mu is the walk's own drift p - q. Instead of the walk's variance 4pq,
+ * sigma^2 = 2 mu / ln(p / q) makes exp(-2 mu x / sigma^2) = (q/p)^x, so the approximation
+ * tends to the exact infinite-horizon answer (see InfiniteHorizon.h) as T grows. The two
+ * agree to within mu^2 and are both 1 at p = 1/2.
+ *
+ * The error still depends on where the bankroll sits, so DiffusionCalibration measures it
+ * against the closed form on a grid of starts at the same odds and horizon, and each
+ * bankroll is quoted with the error of the grid points around it.
+ */
+
+/**
+ * @brief log(Phi(z)), the standard normal CDF, without underflow far in the lower tail.
+ */
+inline double logNormalCdf(double z) {
+    if (z > -30.0) return std::log(0.5 * std::erfc(-z / std::sqrt(2.0)));
+    // Phi(z) = phi(z) / -z * (1 - 1/z^2 + 3/z^4 - ...)
+    const double inverseSquare = 1.0 / (z * z);
+    return -0.5 * z * z - std::log(-z) - 0.5 * LOG_TWO_PI + std::log1p(-inverseSquare * (1.0 - 3.0 * inverseSquare));
+}
+
+/**
+ * @brief The diffusion approximation of a run's ruin probability.
+ * @param startUnits The starting bankroll in bet units (see makeLatticeScenario).
+ * @param numBets The number of bets in a run.
+ * @param houseWinProb The probability (0.0 to 1.0) that the house wins a single bet.
+ */
+inline double diffusionRuinProbability(std::int64_t startUnits, long long numBets, double houseWinProb) {
+    const double p = houseWinProb;
+    const double q = 1.0 - houseWinProb;
+    std::int64_t distance = startUnits - RUIN_THRESHOLD_UNITS + 1;
+
+    // A start below one bet still plays its first bet, like the simulation
+    if (distance < 1) {
+        if (numBets == 0 || distance < 0) return 1.0;
+        return q + p * diffusionRuinProbability(startUnits + 1, numBets - 1, houseWinProb);
+    }
+    if (numBets < distance) return 0.0;
+    if (p <= 0.0 || q <= 0.0) return (p <= 0.0) ? 1.0 : 0.0;
+
+    const double x = static_cast<double>(distance);
+    const double time = static_cast<double>(numBets);
+    const double mu = p - q;
+    const double logRatio = std::log(p / q);
+    const double variance = (mu == 0.0) ? 1.0 : 2.0 * mu / logRatio;
+    const double spread = std::sqrt(variance * time);
+
+    // Both terms in logs: with the drift towards ruin the mirror factor alone overflows
+    double direct = logNormalCdf((-x - mu * time) / spread);
+    double mirror = -x * logRatio + logNormalCdf((-x + mu * time) / spread);
+    double ruin = std::exp(direct) + std::exp(mirror);
+    return (ruin < 1.0) ? ruin : 1.0;
+}
+
+/**
+ * @brief One start of the calibration grid: the diffusion against the closed form.
+ */
+struct DiffusionCalibrationPoint {
+    std::int64_t startUnits;
+    double exact;
+    double approximate;
+    double relativeError;
+};
+
+/**
+ * @brief How far the diffusion is from the exact answer at the odds and horizon of a sweep.
+ */
+struct DiffusionCalibration {
+    std::vector<DiffusionCalibrationPoint> points;  // Ascending starts
+    double largestRelativeError = 0.0;
+
+    /**
+     * @brief The estimated relative error at a start: the larger of the two grid points
+     * around it, or the nearest end point outside the grid.
+     */
+    double estimatedError(std::int64_t startUnits) const {
+        if (points.empty()) return 0.0;
+        std::size_t above = 0;
+        while (above < points.size() && points[above].startUnits < startUnits) ++above;
+        if (above == points.size()) return points.back().relativeError;
+        if (above == 0 || points[above].startUnits == startUnits) return points[above].relativeError;
+        double below = points[above - 1].relativeError;
+        return (below > points[above].relativeError) ? below : points[above].relativeError;
+    }
+};
+
+/**
+ * @brief Compares the diffusion with the closed form at starts 1, 2, 4, ... up to the first
+ * power of two at or past maxStartUnits, or until the exact probability underflows.
+ * Each point costs one closed form, O(numBets).
+ * @param table Log-factorials up to at least numBets.
+ */
+inline DiffusionCalibration calibrateDiffusion(const LogFactorialTable& table, long long numBets, double houseWinProb,
+    std::int64_t maxStartUnits) {
+    DiffusionCalibration calibration;
+    for (std::int64_t start = RUIN_THRESHOLD_UNITS; ; start *= 2) {
+        DiffusionCalibrationPoint point;
+        point.startUnits = start;
+        point.exact = closedFormRuinProbability(table, start, numBets, houseWinProb);
+        if (point.exact < 1e-300) break;
+        point.approximate = diffusionRuinProbability(start, numBets, houseWinProb);
+        point.relativeError = std::fabs(point.approximate - point.exact) / point.exact;
+        if (point.relativeError > calibration.largestRelativeError) calibration.largestRelativeError = point.relativeError;
+        calibration.points.push_back(point);
+        if (start >= maxStartUnits) break;
+    }
+    return calibration;
+}
@@ -0,0 +1,925 @@
+#pragma once
+
+#include <algorithm>    // For min
+#include <chrono>       // For timing each bankroll
+#include <cstdint>
+#include <iomanip>      // For formatting the output (setw, setprecision)
+#include <iostream>
+#include <vector>
+
+#include "ThreadPool.h" // Persistent worker pool for sharding runs across cores
+#include "Engine.h"     // Which simulation engine to run
+#include "Lattice.h"    // Bankrolls in integer bet units
+#include "Philox.h"     // Counter-based random streams
+#include "Bernoulli.h"  // Exact integer-threshold bet outcomes
+#include "LaneKernels.h" // Lane-parallel SIMD kernels with runtime dispatch
+#include "BlockKernel.h" // Block-stepping kernel with jump tables
+#include "ExactSolver.h" // Exact finite-horizon solver
+#include "ClosedForm.h" // Reflection-principle closed form
+#include "InfiniteHorizon.h" // Ruin with no limit on the number of bets
+#include "Diffusion.h"  // Brownian first-passage approximation
+#include "ImportanceSampling.h" // Tilted simulation for rare ruin
+#include "Sweep.h"      // Every bankroll from one set of walks
+#include "EdgeSweep.h"  // Every house win probability from one set of runs
+#include "BankrollSearch.h" // Smallest bankroll for a target ruin probability
+#include "Bridge.h"     // Whole runs in O(log n)
+#include "FirstPassage.h" // Time-to-ruin histogram and hazard curve
+#include "PathRecorder.h" // Bet-by-bet paths in a memory-mapped file
+#include "Results.h"    // Per-bankroll results, console rows and the columnar file
+#include "Adaptive.h"   // Sequential stopping on interval width
+#include "Checkpoint.h" // Saving and resuming an interrupted sweep
+#include "SavedWalks.h" // Carrying runs on to a longer horizon
+#include "Histogram.h"  // Streaming lattice histogram
+#include "Statistics.h" // Mergeable moments and quantile sketch
+#include "Options.h"    // Command-line options
+
+/*
+ * The simulation driver shared by both programs: command-line options, checkpoint and
+ * resume, the dispatch over evaluation modes and engines, and the segment loop that runs
+ * each bankroll. A program supplies only its constants (ProgramConstants) and, if it
+ * charts final bankrolls, the functions that print them.
+ */
+
+/**
+ * @brief Simulates a single run (e.g., one casino's lifetime) of many bets.
+ * @param streamKey The (master seed, scenario) key of the random streams.
+ * @param initialHouseBankroll The starting capital for the house.
+ * @param betAmount The fixed amount of each bet.
+ * @param numBets The total number of bets to simulate in this run.
+ * @param houseWin The house's win probability as a precomputed threshold (see makeBernoulliThreshold).
+ * @param runIndex The index of this run, which selects its own random stream.
+ * @param ruinBet If not null, receives the bet (1 to numBets) after which the house was
+ * ruined. Left untouched if it survived.
+ * @return The final bankroll of the house after the run.
+ * If the house is ruined, this value will be < betAmount.
+ */
+inline double simulateSingleRun(PhiloxKey streamKey, double initialHouseBankroll, double betAmount, long long numBets, const BernoulliThreshold& houseWin, long long runIndex,
+    long long* ruinBet = nullptr) {
+
+    // Position the counter-based generator at the start of this run's stream.
+    // The stream depends only on (master seed, scenario, runIndex), so the run
+    // gives the same result on any thread and in any order.
+    PhiloxStream generator(streamKey, static_cast<std::uint64_t>(runIndex));
+
+
+    double currentBankroll = initialHouseBankroll;
+
+    for (long long i = 0; i < numBets; ++i) {
+        // Simulate one coin flip: an integer compare of the raw word against the threshold
+        if (houseWinsBet(houseWin, generator(), streamKey, static_cast<std::uint64_t>(runIndex), static_cast<std::uint64_t>(i))) {
+            // House wins
+            currentBankroll += betAmount;
+        }
+        else {
+            // Player wins
+            currentBankroll -= betAmount;
+        }
+
+        // Check for ruin
+        if (currentBankroll < betAmount) {
+            // The house doesn't have enough money to cover the next player's win.
+            // They are ruined. Return the current (ruined) bankroll.
+            if (ruinBet) *ruinBet = i + 1;
+            return currentBankroll;
+        }
+    }
+
+    // If the loop finishes, the house survived. Return the final bankroll.
+    return currentBankroll;
+}
+
+/**
+ * @brief The values a program fixes at compile time, and how it charts final bankrolls.
+ *
+ * A program that leaves printHistogram null only counts ruins: no run's final bankroll is
+ * kept, so its hot loop touches one counter per chunk. A program that sets it keeps every
+ * final bankroll in a lattice histogram and mergeable statistics, and prints them with
+ * printHistogram and printStatistics after each bankroll's row.
+ */
+struct ProgramConstants {
+    double houseWinProb = 0.5;           // The house's win probability on a single bet
+    double betAmount = 1.0;              // The fixed bet amount for every game
+    long long betsPerRun = 1;            // The number of bets in a single run
+    long long totalRuns = 1;             // Runs per bankroll, unless --max-runs overrides it
+    std::vector<double> bankrolls;       // The starting bankrolls to test
+    long long runsPerChunk = 1;          // The number of runs a worker thread claims at a time
+    SimulationEngine engine = SimulationEngine::Lanes; // Unless --engine overrides it
+
+    int histogramBins = 0;               // Bars in each final bankroll histogram
+    void (*printHistogram)(const HistogramBins& histogram, bool exact) = nullptr;
+    void (*printStatistics)(const BankrollStatistics& statistics) = nullptr;
+};
+
+/**
+ * @brief Runs every bankroll of a program under the options on its command line.
+ * @return The process exit code: 0 on success, 1 after a bad argument, a failed file or an
+ * interruption that left a checkpoint.
+ */
+inline int runCasinoRuin(const ProgramConstants& program, int argc, char* argv[]) {
+    const double HOUSE_WIN_PROB = program.houseWinProb;
+    const double BET_AMOUNT = program.betAmount;
+    const long long BETS_PER_RUN = program.betsPerRun;
+    const long long RUNS_PER_CHUNK = program.runsPerChunk;
+    const std::vector<double>& bankrollsToTest = program.bankrolls;
+
+    // Final bankrolls are kept only for a program that charts them
+    const bool keepBankrolls = program.printHistogram != nullptr;
+
+    CommandLineOptions options;
+    if (!parseCommandLine(argc, argv, options)) {
+        return 1;
+    }
+
+    // One worker per hardware thread, created once and reused for every bankroll.
+    ThreadPool pool(options.threadCount);
+
+    // Every engine decides bets by comparing raw generator output against this threshold
+    const BernoulliThreshold houseWin = makeBernoulliThreshold(HOUSE_WIN_PROB);
+
+    // The same bet as a payout table, for the infinite-horizon chain
+    const PayoutTable payoutTable = evenMoneyTable(HOUSE_WIN_PROB);
+
+    // Pick the widest SIMD kernel this CPU supports
+    const SimdLevel simdLevel = detectSimdLevel();
+    const RunBatchKernel runBatch = selectRunBatchKernel(simdLevel);
+    const int laneCount = laneCountFor(simdLevel);
+    const BetPatternGenerator betPattern = selectBetPatternGenerator(simdLevel);
+    const EdgeRunKernel edgeRun = selectEdgeRunKernel(simdLevel);
+
+    // The house win probabilities an edge sweep or surface runs at instead of HOUSE_WIN_PROB
+    const bool edgeSurface = options.mode == EvaluationMode::Surface;
+    const bool edgeSweep = options.mode == EvaluationMode::Edges || edgeSurface;
+    const EdgeGrid edgeGrid = makeEdgeGrid(options.edgeFirst, options.edgeLast, options.edgeCount);
+
+    // A bankroll search answers from one set of walks instead of testing bankrollsToTest
+    const bool bankrollSearch = options.mode == EvaluationMode::MinBankroll;
+
+    // A sweep (or search) always walks with the block-stepping kernel, which tracks the running minimum for free
+    SimulationEngine engine = options.engineGiven ? options.engine : program.engine;
+    if (options.mode == EvaluationMode::Sweep || bankrollSearch) engine = SimulationEngine::Block;
+
+    // The lane kernels and the bridge sampler never see the bet a run was ruined at,
+    // so first-passage capture steps those runs with the block-stepping kernel instead
+    const bool recordPassage = options.mode == EvaluationMode::Passage;
+    if (recordPassage && (engine == SimulationEngine::Lanes || engine == SimulationEngine::Bridge)) engine = SimulationEngine::Block;
+
+    // Paths are recorded straight from the block kernel's bet patterns, which already hold one bit per bet
+    const bool recordPaths = !options.recordPath.empty();
+    if (recordPaths) engine = SimulationEngine::Block;
+
+    // Saved walks need every run's ruin bet and a kernel that can start part way through a
+    // run, so they are stepped on the lattice: with the block kernel, or in place of the
+    // reference engine, with the lattice one (which gives the same runs)
+    const bool saveWalks = !options.saveWalksPath.empty();
+    const bool continueWalks = !options.continueWalksPath.empty();
+    if (saveWalks || continueWalks) {
+        if (engine == SimulationEngine::Lanes || engine == SimulationEngine::Bridge) engine = SimulationEngine::Block;
+        if (engine == SimulationEngine::Reference) engine = SimulationEngine::Lattice;
+    }
+
+    // Walks saved by an earlier sweep of the same bankrolls, odds and seed at a shorter horizon
+    SavedWalks walksFrom;
+    if (continueWalks) {
+        if (!walksFrom.open(options.continueWalksPath)) {
+            std::cerr << "Could not read walk file: " << options.continueWalksPath << std::endl;
+            return 1;
+        }
+        const WalkFileHeader& from = walksFrom.info();
+        if (options.masterSeedGiven && options.masterSeed != from.masterSeed) {
+            std::cerr << "--seed differs from the walk file's master seed " << from.masterSeed << std::endl;
+            return 1;
+        }
+        options.masterSeed = from.masterSeed;
+        bool sameSweep = from.houseWinProb == HOUSE_WIN_PROB && from.betAmount == BET_AMOUNT
+            && from.scenarioCount == bankrollsToTest.size() && from.horizon <= static_cast<std::uint64_t>(BETS_PER_RUN);
+        for (std::uint32_t s = 0; sameSweep && s < from.scenarioCount; ++s) {
+            sameSweep = walksFrom.scenario(s).startBankroll == bankrollsToTest[s];
+        }
+        if (!sameSweep) {
+            std::cerr << "Walk file " << options.continueWalksPath << " was saved for other bankrolls, odds or a longer horizon" << std::endl;
+            return 1;
+        }
+    }
+
+    // A checkpoint records the settings it was taken under, and the state of the sweep so far
+    const bool checkpointing = !options.checkpointPath.empty();
+    const bool continuing = options.resume || options.extendRuns > 0;
+    CheckpointState checkpoint;
+    if (continuing) {
+        if (!readCheckpoint(options.checkpointPath, checkpoint)) {
+            std::cerr << "Could not read checkpoint: " << options.checkpointPath << std::endl;
+            return 1;
+        }
+        if (options.masterSeedGiven && options.masterSeed != checkpoint.masterSeed) {
+            std::cerr << "--seed differs from the checkpoint's master seed " << checkpoint.masterSeed << std::endl;
+            return 1;
+        }
+        options.masterSeed = checkpoint.masterSeed;
+    }
+
+    // Runs per bankroll: totalRuns unless --max-runs overrides it; a sweep continued from a
+    // checkpoint keeps its own, plus any --extend, and continued walks are the runs saved.
+    // With a precision target this is only the budget, and each bankroll stops as soon as it meets the target.
+    const long long runBudget = continuing ? checkpoint.runBudget + options.extendRuns
+        : continueWalks ? static_cast<long long>(walksFrom.info().runsPerScenario)
+        : (options.maxRuns > 0) ? options.maxRuns : program.totalRuns;
+    if (continuing && options.maxRuns > 0 && options.maxRuns != runBudget) {
+        std::cerr << "--max-runs differs from the checkpoint's run budget of " << runBudget << " (raise it with --extend)" << std::endl;
+        return 1;
+    }
+    StoppingRule stopping;
+    stopping.absoluteHalfWidth = options.targetAbsolute;
+    stopping.relativeHalfWidth = options.targetRelative;
+    stopping.maxRuns = runBudget;
+
+    CheckpointState settings;
+    settings.masterSeed = options.masterSeed;
+    settings.mode = options.mode;
+    settings.engine = engine;
+    settings.betsPerRun = BETS_PER_RUN;
+    settings.houseWinProb = HOUSE_WIN_PROB;
+    settings.betAmount = BET_AMOUNT;
+    settings.targetAbsolute = stopping.absoluteHalfWidth;
+    settings.targetRelative = stopping.relativeHalfWidth;
+    settings.bankrolls = bankrollsToTest;
+    if (!continuing) {
+        checkpoint = settings;
+    }
+    else if (!checkpoint.sameSettings(settings)) {
+        std::cerr << "Checkpoint " << options.checkpointPath << " was written with different settings" << std::endl;
+        return 1;
+    }
+    checkpoint.runBudget = runBudget;
+    if (checkpointing) {
+        installCheckpointSignalHandlers();
+    }
+
+    // log-factorials for the closed form (also a bankroll search's exact answer) and the bridge sampler, shared by every bankroll
+    const bool needLogFactorials = options.mode == EvaluationMode::ClosedForm || bankrollSearch
+        || options.mode == EvaluationMode::Diffusion
+        || (engine == SimulationEngine::Bridge && !isComputedMode(options.mode));
+    const LogFactorialTable logFactorials(needLogFactorials ? BETS_PER_RUN : 0);
+
+    // The diffusion's error, measured against the closed form on starts up to the largest bankroll
+    DiffusionCalibration calibration;
+    if (options.mode == EvaluationMode::Diffusion) {
+        std::int64_t maxStartUnits = RUIN_THRESHOLD_UNITS;
+        for (double bankroll : bankrollsToTest) {
+            std::int64_t startUnits = makeLatticeScenario(bankroll, BET_AMOUNT).startUnits;
+            if (startUnits > maxStartUnits) maxStartUnits = startUnits;
+        }
+        calibration = calibrateDiffusion(logFactorials, BETS_PER_RUN, HOUSE_WIN_PROB, maxStartUnits);
+    }
+
+    // The path file is sized for every recorded run up front, so runs can be written in any order
+    PathRecorder recorder;
+    if (recordPaths) {
+        long long recordRuns = (options.recordRuns < 0 || options.recordRuns > runBudget) ? runBudget : options.recordRuns;
+        if (!recorder.open(options.recordPath, static_cast<std::uint32_t>(bankrollsToTest.size()),
+                static_cast<std::uint64_t>(recordRuns), BETS_PER_RUN, options.masterSeed)) {
+            std::cerr << "Could not create path file: " << options.recordPath << std::endl;
+            return 1;
+        }
+    }
+
+    // Every run's slot in the walk file is known up front too
+    SavedWalks walksTo;
+    if (saveWalks && !walksTo.create(options.saveWalksPath, static_cast<std::uint32_t>(bankrollsToTest.size()),
+            static_cast<std::uint64_t>(runBudget), BETS_PER_RUN, options.masterSeed, HOUSE_WIN_PROB, BET_AMOUNT)) {
+        std::cerr << "Could not create walk file: " << options.saveWalksPath << std::endl;
+        return 1;
+    }
+
+
+    // --- Simulation Start ---
+    if (!options.quiet) {
+        std::cout << "--- Casino Ruin Simulation ---" << std::endl;
+        if (edgeSweep) {
+            std::cout << "House Win Probabilities: " << edgeGrid.size() << " from " << (options.edgeFirst * 100.0)
+                << "% to " << (options.edgeLast * 100.0) << "%" << std::endl;
+        }
+        else {
+            std::cout << "House Win Probability: " << (HOUSE_WIN_PROB * 100.0) << "%" << std::endl;
+        }
+        std::cout << "Bet Amount: $" << BET_AMOUNT << std::endl;
+        if (options.mode == EvaluationMode::Infinite) {
+            std::cout << "Solving for ruin at any time, with no limit on the number of bets..." << std::endl;
+            std::cout << "Mode: " << evaluationModeName(options.mode) << std::endl;
+        }
+        else if (options.mode == EvaluationMode::Diffusion) {
+            std::cout << "Approximating runs of " << BETS_PER_RUN << " bets..." << std::endl;
+            std::cout << "Mode: " << evaluationModeName(options.mode) << std::endl;
+            std::cout << "Calibration: " << calibration.points.size() << " starts up to "
+                << (calibration.points.empty() ? 0 : calibration.points.back().startUnits)
+                << " units against the closed form, largest relative error " << std::setprecision(2) << std::scientific
+                << calibration.largestRelativeError << std::defaultfloat << std::setprecision(6) << std::endl;
+        }
+        else if (isExactMode(options.mode)) {
+            std::cout << "Solving runs of " << BETS_PER_RUN << " bets exactly..." << std::endl;
+            std::cout << "Mode: " << evaluationModeName(options.mode) << std::endl;
+        }
+        else {
+            if (stopping.enabled()) {
+                std::cout << "Simulating up to " << runBudget << " runs of " << BETS_PER_RUN
+                    << " bets each, until the 95% interval half-width is at most ";
+                if (stopping.absoluteHalfWidth > 0.0) {
+                    std::cout << stopping.absoluteHalfWidth << (stopping.relativeHalfWidth > 0.0 ? " or " : "");
+                }
+                if (stopping.relativeHalfWidth > 0.0) {
+                    std::cout << (stopping.relativeHalfWidth * 100.0) << "% of the estimate";
+                }
+                std::cout << "..." << std::endl;
+            }
+            else {
+                std::cout << "Simulating " << runBudget << " runs of "
+                    << BETS_PER_RUN << " bets each..." << std::endl;
+            }
+            std::cout << "Worker Threads: " << pool.size() << std::endl;
+            std::cout << "Master Seed: " << options.masterSeed << " (replay with --seed=" << options.masterSeed << ")" << std::endl;
+            std::cout << "Engine: " << (edgeSweep ? "One lane per win probability" : engineName(engine));
+            if (edgeSweep || engine == SimulationEngine::Lanes) {
+                std::cout << " (" << simdLevelName(simdLevel) << ", " << laneCount << " lanes)";
+            }
+            else if (engine == SimulationEngine::Block) {
+                std::cout << " (" << simdLevelName(simdLevel) << ")";
+            }
+            std::cout << std::endl;
+            if (options.mode == EvaluationMode::Sweep || options.mode == EvaluationMode::Passage || edgeSweep) {
+                std::cout << "Mode: " << evaluationModeName(options.mode) << std::endl;
+            }
+            else if (bankrollSearch) {
+                std::cout << "Mode: " << evaluationModeName(options.mode) << " (ruin probability at most "
+                    << (options.ruinTarget * 100.0) << "%, at " << (options.confidence * 100.0) << "% confidence)" << std::endl;
+            }
+            else if (options.mode == EvaluationMode::Importance) {
+                std::cout << "Mode: " << evaluationModeName(options.mode) << " (runs simulated at a house win probability of "
+                    << (tiltedWinProbability(HOUSE_WIN_PROB, RUIN_THRESHOLD_UNITS) * 100.0) << "%)" << std::endl;
+            }
+            if (recordPaths) {
+                std::cout << "Recording: " << recorder.runsPerScenario() << " runs per bankroll to " << options.recordPath << std::endl;
+            }
+            if (continueWalks) {
+                std::cout << "Continuing: the runs in " << options.continueWalksPath << ", from bet "
+                    << walksFrom.info().horizon << " for the survivors" << std::endl;
+            }
+            if (saveWalks) {
+                std::cout << "Saving walks: " << options.saveWalksPath << std::endl;
+            }
+            if (checkpointing) {
+                std::cout << "Checkpoint: " << options.checkpointPath << " (every " << options.checkpointSeconds << " s)" << std::endl;
+            }
+            if (continuing) {
+                std::cout << (options.extendRuns > 0 ? "Extending: " : "Resuming: ") << checkpoint.scenariosDone() << " of "
+                    << bankrollsToTest.size() << " bankrolls done";
+                if (!checkpoint.scenarios.empty() && !checkpoint.scenarios.back().complete) {
+                    std::cout << ", " << checkpoint.scenarios.back().runsDone << " runs into the next";
+                }
+                std::cout << std::endl;
+            }
+        }
+        std::cout << "--------------------------------------------------------" << std::endl;
+        std::cout << std::fixed << std::setprecision(5);
+        // (A surface is printed as whole matrices once every bankroll is done, a search as its answers)
+        if (!edgeSurface && !bankrollSearch) {
+            std::cout << std::setw(18) << "House Bankroll" << " | "
+                << std::setw(12) << "Ruin Count" << " | "
+                << "Ruin Prob (%)" << std::endl;
+            std::cout << "--------------------------------------------------------" << std::endl;
+        }
+    }
+
+    const std::chrono::steady_clock::time_point runStart = std::chrono::steady_clock::now();
+
+    // A sweep simulates every walk once, up front, under the first scenario's key
+    std::vector<SweepTally> sweep;
+    std::vector<std::size_t> sweepLevelIndex;
+    if (options.mode == EvaluationMode::Sweep) {
+        std::vector<std::int64_t> startUnits;
+        for (double bankroll : bankrollsToTest) {
+            startUnits.push_back(makeLatticeScenario(bankroll, BET_AMOUNT).startUnits);
+        }
+        std::vector<std::int64_t> levels = sortedSweepLevels(startUnits, sweepLevelIndex);
+        std::vector<LatticeScenario> levelLattices;
+        if (keepBankrolls) {
+            levelLattices.resize(bankrollsToTest.size());
+            for (std::size_t i = 0; i < bankrollsToTest.size(); ++i) {
+                levelLattices[sweepLevelIndex[i]] = makeLatticeScenario(bankrollsToTest[i], BET_AMOUNT);
+            }
+        }
+        sweep = simulateSweep(pool, betPattern, makeStreamKey(options.masterSeed, 0), BETS_PER_RUN, houseWin, runBudget, RUNS_PER_CHUNK,
+            levels, levelLattices);
+    }
+
+    // So does a surface, at every win probability of the grid
+    SurfaceResults surface;
+    if (edgeSurface) {
+        std::vector<std::int64_t> startUnits;
+        for (double bankroll : bankrollsToTest) {
+            startUnits.push_back(makeLatticeScenario(bankroll, BET_AMOUNT).startUnits);
+        }
+        surface = simulateEdgeSurface(pool, edgeRun, makeStreamKey(options.masterSeed, 0), startUnits, BETS_PER_RUN,
+            edgeGrid, runBudget, RUNS_PER_CHUNK);
+    }
+
+    // Every bankroll's numbers, for the results file
+    std::vector<ScenarioResult> results;
+
+    // A bankroll search simulates its walks once, up front, too, and answers from how deep each one fell
+    if (bankrollSearch) {
+        const RuinDepths depths = simulateRuinDepths(pool, betPattern, makeStreamKey(options.masterSeed, 0), BETS_PER_RUN,
+            houseWin, runBudget, RUNS_PER_CHUNK);
+        const BankrollSearchResult search = searchSmallestBankroll(logFactorials, BETS_PER_RUN, HOUSE_WIN_PROB, depths,
+            options.ruinTarget, options.confidence);
+        if (!options.quiet) {
+            printBankrollSearch(search, BET_AMOUNT);
+        }
+
+        // For the results file: the exact answer, then the simulated one if the runs could show it
+        ScenarioResult answer;
+        answer.mode = EvaluationMode::ClosedForm;
+        answer.startBankroll = search.exactUnits * BET_AMOUNT;
+        answer.betAmount = BET_AMOUNT;
+        answer.houseWinProb = HOUSE_WIN_PROB;
+        answer.betsPerRun = BETS_PER_RUN;
+        answer.ruinProbability = search.exactProbability;
+        answer.interval.low = search.exactProbability;
+        answer.interval.high = search.exactProbability;
+        answer.elapsedSeconds = secondsSince(runStart);
+        results.push_back(answer);
+        if (search.confidentUnits >= 0) {
+            answer.mode = EvaluationMode::MinBankroll;
+            answer.startBankroll = search.confidentUnits * BET_AMOUNT;
+            answer.totalRuns = search.runs;
+            answer.ruinCount = search.confidentRuins;
+            answer.ruinProbability = static_cast<double>(search.confidentRuins) / search.runs;
+            answer.interval = clopperPearsonInterval(search.confidentRuins, search.runs, 2.0 * (1.0 - options.confidence));
+            results.push_back(answer);
+        }
+    }
+
+    // Prints a simulated bankroll: its row, then whatever was charted for it
+    auto printSimulatedScenario = [&](const SavedScenario& scenario) {
+        printScenarioRow(scenario.result);
+        if (!keepBankrolls) {
+            if (recordPassage) {
+                printPassageTable(scenario.passage, scenario.result.totalRuns);
+            }
+            return;
+        }
+        if (scenario.result.mode == EvaluationMode::Importance) {
+            std::cout << "    (No histogram: surviving runs were simulated at the tilted probability.)" << std::endl;
+        }
+        else {
+            program.printHistogram(scenario.result.histogram, false);
+            program.printStatistics(scenario.statistics);
+            if (recordPassage) {
+                printPassageTable(scenario.passage, scenario.result.totalRuns);
+            }
+        }
+        std::cout << std::endl; // Add a blank line for readability
+    };
+
+    // Saves the sweep so far; a failed write is reported but does not stop the sweep
+    std::chrono::steady_clock::time_point lastCheckpoint = std::chrono::steady_clock::now();
+    auto saveCheckpoint = [&]() {
+        if (!writeCheckpoint(options.checkpointPath, checkpoint)) {
+            std::cerr << "Could not write checkpoint: " << options.checkpointPath << std::endl;
+        }
+        lastCheckpoint = std::chrono::steady_clock::now();
+    };
+
+    // Loop over each bankroll we want to test (none in a bankroll search)
+    const std::size_t scenarioCount = bankrollSearch ? 0 : bankrollsToTest.size();
+    for (std::size_t scenarioId = 0; scenarioId < scenarioCount; ++scenarioId) {
+        double startBankroll = bankrollsToTest[scenarioId];
+
+        // (A sweep's shared walks are timed as part of the first bankroll)
+        const std::chrono::steady_clock::time_point scenarioStart = (scenarioId == 0) ? runStart : std::chrono::steady_clock::now();
+        ScenarioResult result;
+        result.mode = options.mode;
+        result.startBankroll = startBankroll;
+        result.betAmount = BET_AMOUNT;
+        result.houseWinProb = HOUSE_WIN_PROB;
+        result.betsPerRun = BETS_PER_RUN;
+        result.totalRuns = runBudget;
+
+        // Every run of this bankroll draws from its own stream under this key
+        const PhiloxKey streamKey = makeStreamKey(options.masterSeed, scenarioId);
+
+        // Every engine except Reference works in whole bet units
+        const LatticeScenario lattice = makeLatticeScenario(startBankroll, BET_AMOUNT);
+
+        if (options.mode == EvaluationMode::Diffusion) {
+            // An approximation, quoted with the calibration's error around this start
+            const double ruinProbability = diffusionRuinProbability(lattice.startUnits, BETS_PER_RUN, HOUSE_WIN_PROB);
+            const double error = calibration.estimatedError(lattice.startUnits);
+            result.totalRuns = 0;
+            result.ruinCount = -1;
+            result.ruinProbability = ruinProbability;
+            result.relativeError = error;
+            result.interval.low = ruinProbability * (1.0 - error);
+            result.interval.high = ruinProbability * (1.0 + error);
+            result.elapsedSeconds = secondsSince(scenarioStart);
+
+            if (!options.quiet) {
+                printScenarioRow(result);
+            }
+            results.push_back(result);
+            continue;
+        }
+
+        if (options.mode == EvaluationMode::Infinite) {
+            // Ever ruined: no horizon, so no surviving bankrolls to chart either
+            const double ruinProbability = infiniteHorizonRuinProbability(payoutTable, lattice.startUnits);
+            result.betsPerRun = 0;
+            result.totalRuns = 0;
+            result.ruinCount = -1;
+            result.ruinProbability = ruinProbability;
+            result.interval.low = ruinProbability;
+            result.interval.high = ruinProbability;
+            result.elapsedSeconds = secondsSince(scenarioStart);
+
+            if (!options.quiet) {
+                printScenarioRow(result);
+                if (keepBankrolls) {
+                    std::cout << std::endl; // Add a blank line for readability
+                }
+            }
+            results.push_back(result);
+            continue;
+        }
+
+        if (isExactMode(options.mode)) {
+            // No sampling: the probabilities themselves, up to double rounding. The whole
+            // final distribution is only solved for when it is charted.
+            result.totalRuns = 0;
+            result.ruinCount = -1;
+            if (keepBankrolls) {
+                ExactDistribution exact = (options.mode == EvaluationMode::ClosedForm)
+                    ? closedFormDistribution(logFactorials, lattice.startUnits, BETS_PER_RUN, HOUSE_WIN_PROB)
+                    : solveFiniteHorizon(lattice.startUnits, BETS_PER_RUN, HOUSE_WIN_PROB);
+                result.ruinProbability = exact.ruinProbability;
+                result.histogram = binLatticeWeights(exact.lowestUnits, exact.survivingProbability, lattice, program.histogramBins);
+            }
+            else {
+                result.ruinProbability = (options.mode == EvaluationMode::ClosedForm)
+                    ? closedFormRuinProbability(logFactorials, lattice.startUnits, BETS_PER_RUN, HOUSE_WIN_PROB)
+                    : solveFiniteHorizon(lattice.startUnits, BETS_PER_RUN, HOUSE_WIN_PROB).ruinProbability;
+            }
+            result.interval.low = result.ruinProbability;
+            result.interval.high = result.ruinProbability;
+            result.elapsedSeconds = secondsSince(scenarioStart);
+
+            if (!options.quiet) {
+                printScenarioRow(result);
+                if (keepBankrolls) {
+                    program.printHistogram(result.histogram, true);
+                    std::cout << std::endl; // Add a blank line for readability
+                }
+            }
+            results.push_back(result);
+            continue;
+        }
+
+        if (options.mode == EvaluationMode::Sweep) {
+            // Answered from the shared walks: ruined where the walk reached this bankroll's level
+            const SweepTally& tally = sweep[sweepLevelIndex[scenarioId]];
+            long long ruinCount = tally.ruinCount;
+
+            result.ruinCount = ruinCount;
+            result.ruinProbability = static_cast<double>(ruinCount) / runBudget;
+            result.interval = wilsonInterval(ruinCount, runBudget);
+            if (keepBankrolls) {
+                result.histogram = binLatticeWeights(tally.histogram.lowestPosition(), tally.histogram.weights(), lattice, program.histogramBins);
+            }
+            result.elapsedSeconds = secondsSince(scenarioStart);
+
+            if (!options.quiet) {
+                printScenarioRow(result);
+                if (ruinCount > 0) {
+                    std::cout << "    Mean bets to ruin: " << std::setprecision(1)
+                        << (static_cast<double>(tally.totalBetsToRuin) / ruinCount) << std::setprecision(5) << std::endl;
+                }
+                if (keepBankrolls) {
+                    program.printHistogram(result.histogram, false);
+                    program.printStatistics(tally.statistics);
+                    std::cout << std::endl; // Add a blank line for readability
+                }
+            }
+            results.push_back(result);
+            continue;
+        }
+
+        if (edgeSurface) {
+            // A row of the surface: this bankroll at every win probability, printed with the rest below
+            for (std::size_t e = 0; e < surface.edges; ++e) {
+                long long ruinCount = surface.ruinCounts[scenarioId * surface.edges + e];
+                ScenarioResult cell = result;
+                cell.houseWinProb = edgeGrid.probabilities[e];
+                cell.ruinCount = ruinCount;
+                cell.ruinProbability = static_cast<double>(ruinCount) / runBudget;
+                cell.interval = wilsonInterval(ruinCount, runBudget);
+                cell.elapsedSeconds = secondsSince(scenarioStart);
+                results.push_back(cell);
+            }
+            continue;
+        }
+
+        if (edgeSweep) {
+            // Every win probability of the grid from the same runs: one row, and one result, each
+            std::vector<long long> ruinCounts = simulateEdgeSweep(pool, edgeRun, streamKey, lattice.startUnits, BETS_PER_RUN,
+                edgeGrid, runBudget, RUNS_PER_CHUNK);
+            const double elapsed = secondsSince(scenarioStart);
+            for (int e = 0; e < edgeGrid.size(); ++e) {
+                ScenarioResult edgeResult = result;
+                edgeResult.houseWinProb = edgeGrid.probabilities[e];
+                edgeResult.ruinCount = ruinCounts[e];
+                edgeResult.ruinProbability = static_cast<double>(ruinCounts[e]) / runBudget;
+                edgeResult.interval = wilsonInterval(ruinCounts[e], runBudget);
+                edgeResult.elapsedSeconds = elapsed;
+                if (!options.quiet) {
+                    printScenarioRow(edgeResult);
+                }
+                results.push_back(edgeResult);
+            }
+            if (!options.quiet) {
+                std::cout << std::endl; // Add a blank line for readability
+            }
+            continue;
+        }
+
+        // Where this bankroll got to in the checkpoint; one finished there is printed again
+        if (scenarioId == checkpoint.scenarios.size()) {
+            checkpoint.scenarios.push_back(SavedScenario());
+        }
+        SavedScenario& saved = checkpoint.scenarios[scenarioId];
+        if (saved.doneWithin(runBudget)) {
+            if (!options.quiet) {
+                printSimulatedScenario(saved);
+            }
+            results.push_back(saved.result);
+            continue;
+        }
+        saved.complete = false;
+
+        // Importance sampling simulates the same runs with the win probability tilted towards ruin
+        const double simulatedWinProb = (options.mode == EvaluationMode::Importance)
+            ? tiltedWinProbability(HOUSE_WIN_PROB, lattice.startUnits)
+            : HOUSE_WIN_PROB;
+        const BernoulliThreshold simulatedWin = makeBernoulliThreshold(simulatedWinProb);
+        if (recordPaths) {
+            recorder.describeScenario(static_cast<std::uint32_t>(scenarioId), startBankroll, BET_AMOUNT, simulatedWinProb, lattice.startUnits);
+        }
+        if (saveWalks) {
+            walksTo.describeScenario(static_cast<std::uint32_t>(scenarioId), startBankroll, lattice.startUnits);
+        }
+        const long long walksFromBet = continueWalks ? static_cast<long long>(walksFrom.info().horizon) : 0;
+
+        // The bridge sampler's CDF table depends on the win probability, so it is built per bankroll
+        BridgeSampler bridge;
+        if (engine == SimulationEngine::Bridge) {
+            bridge = BridgeSampler(logFactorials, BETS_PER_RUN, simulatedWinProb);
+        }
+
+        // Each thread keeps its own ruin counter, padded so neighbouring
+        // counters never share a cache line.
+        std::vector<CacheLinePadded<long long>> ruinCounts(pool.size());
+
+        // Where final bankrolls are kept, each thread also folds its runs into its own
+        // histogram as they finish, so the hot loop never touches memory shared with another thread.
+        std::vector<CacheLinePadded<LatticeHistogram>> perThread(pool.size());
+        if (keepBankrolls) {
+            for (CacheLinePadded<LatticeHistogram>& slot : perThread) {
+                slot.value = LatticeHistogram(lattice.startUnits, BETS_PER_RUN);
+            }
+        }
+
+        // Moments and quantiles are merged chunk by chunk in run order, so they
+        // come out bit-identical for any number of threads
+        OrderedMerge<BankrollStatistics> statisticsByChunk;
+
+        // First-passage times, also per thread; only ruined runs touch them
+        std::vector<CacheLinePadded<PassageHistogram>> passageByThread(pool.size());
+        if (recordPassage) {
+            for (CacheLinePadded<PassageHistogram>& slot : passageByThread) {
+                slot.value = PassageHistogram(BETS_PER_RUN);
+            }
+        }
+
+        // Folds the accumulators so far into the bankroll's saved state
+        auto saveProgress = [&](SavedScenario& state, long long runs, long long nextLook, int looks, double elapsed) {
+            state.runsDone = runs;
+            state.lookEnd = nextLook;
+            state.look = looks;
+            state.elapsedSeconds = elapsed;
+            state.ruinCount = 0;
+            for (const CacheLinePadded<long long>& slot : ruinCounts) {
+                state.ruinCount += slot.value;
+            }
+            state.histogram = LatticeHistogram();
+            for (const CacheLinePadded<LatticeHistogram>& slot : perThread) {
+                state.histogram.merge(slot.value);
+            }
+            state.statistics = statisticsByChunk.result();
+            state.passage = PassageHistogram();
+            for (const CacheLinePadded<PassageHistogram>& slot : passageByThread) {
+                state.passage.merge(slot.value);
+            }
+        };
+
+        // Carry on from the checkpoint's accumulators, if it got part way through this bankroll
+        // (or all the way through a smaller budget)
+        if (saved.runsDone > 0) {
+            ruinCounts[0].value = saved.ruinCount;
+            if (keepBankrolls) {
+                perThread[0].value = saved.histogram;
+                statisticsByChunk.resume(saved.statistics, saved.runsDone);
+            }
+            if (recordPassage) {
+                passageByThread[0].value = saved.passage;
+            }
+        }
+        const double elapsedBefore = saved.elapsedSeconds;
+
+        // Run the main simulation loop, sharded across the worker pool: all runs at once, or
+        // with a precision target, in batches of run indices up to each look until the target
+        // is met. With checkpoints, batches are cut into segments with a save point after each.
+        long long runsDone = saved.runsDone;
+        long long lookEnd = saved.lookEnd;
+        int look = saved.look;
+        bool targetMet = false;
+        ConfidenceInterval stoppedInterval;
+        const double ruinWeight = (options.mode == EvaluationMode::Importance) ? importanceWeight(lattice.startUnits, HOUSE_WIN_PROB) : 1.0;
+        while (runsDone < runBudget && !targetMet) {
+            if (runsDone == lookEnd) {
+                lookEnd = stopping.enabled() ? nextLookRuns(runsDone, RUNS_PER_CHUNK, runBudget) : runBudget;
+            }
+            const long long batchEnd = checkpointing ? std::min(lookEnd, runsDone + CHECKPOINT_SEGMENT_CHUNKS * RUNS_PER_CHUNK) : lookEnd;
+            pool.parallelForRange(runsDone, batchEnd, RUNS_PER_CHUNK, [&](unsigned threadIndex, long long begin, long long end) {
+                // Ruins are counted per chunk and added to the thread's counter once, at its end
+                long long localRuins = 0;
+                LatticeHistogram& histogram = perThread[threadIndex].value;
+                BankrollStatistics statistics;
+                if (engine == SimulationEngine::Lanes) {
+                    std::int64_t batchUnits[MAX_LANES];
+                    for (long long i = begin; i < end; i += laneCount) {
+                        int lanes = static_cast<int>(std::min<long long>(laneCount, end - i));
+                        runBatch(streamKey, lattice.startUnits, BETS_PER_RUN, simulatedWin, i, lanes, batchUnits);
+                        for (int k = 0; k < lanes; ++k) {
+                            if (batchUnits[k] < RUIN_THRESHOLD_UNITS) {
+                                localRuins++;
+                            }
+                            if (keepBankrolls) {
+                                histogram.add(batchUnits[k]);
+                                statistics.add(unitsToDollars(lattice, batchUnits[k]));
+                            }
+                        }
+                    }
+                }
+                else {
+                    long long ruinBet = 0;
+                    long long* ruinBetOut = (recordPassage || recordPaths || saveWalks || continueWalks) ? &ruinBet : nullptr;
+                    for (long long i = begin; i < end; ++i) {
+                        std::int64_t units;
+                        std::uint64_t* path = recordPaths ? recorder.pathWords(static_cast<std::uint32_t>(scenarioId), i) : nullptr;
+                        if (continueWalks) {
+                            // Ruined runs stay as they were saved; survivors step on from the saved horizon
+                            WalkState walk = walksFrom.state(static_cast<std::uint32_t>(scenarioId), i);
+                            units = walk.units;
+                            if (walk.ruinBet > 0) {
+                                ruinBet = walk.ruinBet;
+                            }
+                            else if (engine == SimulationEngine::Block) {
+                                units = continueBlockRun(betPattern, streamKey, walk.units, walksFromBet, BETS_PER_RUN, simulatedWin, i, ruinBetOut);
+                            }
+                            else {
+                                units = continueLatticeRun(streamKey, walk.units, walksFromBet, BETS_PER_RUN, simulatedWin, i, ruinBetOut);
+                            }
+                        }
+                        else if (engine == SimulationEngine::Block) {
+                            units = simulateBlockRun(betPattern, streamKey, lattice.startUnits, BETS_PER_RUN, simulatedWin, i, ruinBetOut, path);
+                        }
+                        else if (engine == SimulationEngine::Bridge && lattice.startUnits >= RUIN_THRESHOLD_UNITS) {
+                            units = bridge.sample(streamKey, lattice.startUnits, i);
+                        }
+                        else if (engine == SimulationEngine::Lattice || engine == SimulationEngine::Bridge) {
+                            // (A start below one bet is stepped even by the bridge engine)
+                            units = simulateLatticeRun(streamKey, lattice.startUnits, BETS_PER_RUN, simulatedWin, i, ruinBetOut);
+                        }
+                        else {
+                            double finalBankroll = simulateSingleRun(streamKey, startBankroll, BET_AMOUNT, BETS_PER_RUN, simulatedWin, i, ruinBetOut);
+                            units = dollarsToUnits(lattice, finalBankroll);
+                        }
+                        bool ruined = units < RUIN_THRESHOLD_UNITS;
+                        if (ruined) {
+                            localRuins++;
+                            if (recordPassage) {
+                                passageByThread[threadIndex].value.add(ruinBet);
+                            }
+                        }
+                        if (keepBankrolls) {
+                            histogram.add(units);
+                            statistics.add(unitsToDollars(lattice, units));
+                        }
+                        if (path) {
+                            recorder.finishRun(static_cast<std::uint32_t>(scenarioId), i, ruined ? ruinBet : BETS_PER_RUN, units);
+                        }
+                        if (saveWalks) {
+                            walksTo.saveState(static_cast<std::uint32_t>(scenarioId), i, units, ruined ? ruinBet : 0);
+                        }
+                    }
+                }
+                ruinCounts[threadIndex].value += localRuins;
+                if (keepBankrolls) {
+                    statisticsByChunk.submit(begin, end, std::move(statistics));
+                }
+            });
+
+            runsDone = batchEnd;
+
+            if (stopping.enabled() && runsDone == lookEnd) {
+                long long ruinsSoFar = 0;
+                for (const CacheLinePadded<long long>& slot : ruinCounts) {
+                    ruinsSoFar += slot.value;
+                }
+                stoppedInterval = sequentialInterval(ruinsSoFar, runsDone, ruinWeight, stopping.alpha, ++look);
+                targetMet = stoppingTargetMet(stopping, stoppedInterval, ruinWeight * static_cast<double>(ruinsSoFar) / static_cast<double>(runsDone));
+            }
+
+            // Save mid-bankroll only while runs remain; a finished bankroll is saved below
+            bool moreRuns = runsDone < runBudget && !targetMet;
+            if (checkpointing && moreRuns && (checkpointSignalled() || secondsSince(lastCheckpoint) >= options.checkpointSeconds)) {
+                saveProgress(saved, runsDone, lookEnd, look, elapsedBefore + secondsSince(scenarioStart));
+                saveCheckpoint();
+                if (checkpointSignalled()) {
+                    std::cerr << "Interrupted: checkpoint written to " << options.checkpointPath << " (continue with --resume)" << std::endl;
+                    return 1;
+                }
+            }
+        }
+
+        // Merge the per-thread counters and histograms
+        long long ruinCount = 0;
+        for (const CacheLinePadded<long long>& slot : ruinCounts) {
+            ruinCount += slot.value;
+        }
+        LatticeHistogram histogram;
+        for (const CacheLinePadded<LatticeHistogram>& slot : perThread) {
+            histogram.merge(slot.value);
+        }
+
+        result.ruinCount = ruinCount;
+        result.totalRuns = runsDone;
+        result.adaptive = stopping.enabled();
+        result.targetMet = targetMet;
+        if (options.mode == EvaluationMode::Importance) {
+            // Every ruined run carries the same likelihood-ratio weight
+            RuinEstimate estimate = importanceSamplingEstimate(ruinCount, runsDone, lattice.startUnits, HOUSE_WIN_PROB);
+            result.ruinProbability = estimate.probability;
+            result.interval = stopping.enabled() ? stoppedInterval : scaledInterval(wilsonInterval(ruinCount, runsDone), estimate.weight);
+            result.relativeError = estimate.relativeError;
+        }
+        else {
+            // Calculate the result for this bankroll
+            result.ruinProbability = static_cast<double>(ruinCount) / runsDone;
+            result.interval = stopping.enabled() ? stoppedInterval : wilsonInterval(ruinCount, runsDone);
+            if (keepBankrolls) {
+                result.histogram = binLatticeWeights(histogram.lowestPosition(), histogram.weights(), lattice, program.histogramBins);
+            }
+        }
+        result.elapsedSeconds = elapsedBefore + secondsSince(scenarioStart);
+
+        saveProgress(saved, runsDone, lookEnd, look, result.elapsedSeconds);
+        saved.complete = true;
+        saved.result = result;
+
+        if (!options.quiet) {
+            printSimulatedScenario(saved);
+        }
+        results.push_back(result);
+
+        if (checkpointing) {
+            saveCheckpoint();
+            if (checkpointSignalled() && scenarioId + 1 < bankrollsToTest.size()) {
+                std::cerr << "Interrupted: checkpoint written to " << options.checkpointPath << " (continue with --resume)" << std::endl;
+                return 1;
+            }
+        }
+    }
+
+    if (edgeSurface && !options.quiet) {
+        printSurfaceTable(results, surface.edges);
+    }
+
+    if (!options.resultsPath.empty() && !writeResultsFile(options.resultsPath, options.masterSeed, results)) {
+        std::cerr << "Could not write results file: " << options.resultsPath << std::endl;
+        return 1;
+    }
+
+    if (!options.quiet) {
+        std::cout << "--------------------------------------------------------" << std::endl;
+        std::cout << "Simulation complete." << std::endl;
+    }
+
+    return 0;
+}
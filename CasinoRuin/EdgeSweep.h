@@ -0,0 +1,435 @@
+#pragma once
+
+#include <algorithm>    // For upper_bound
+#include <cstdint>
+#include <limits>
+#include <vector>
+
+#include "CpuFeatures.h"
+#include "Engine.h"     // For MAX_EDGES
+#include "Lattice.h"
+#include "Philox.h"
+#include "Bernoulli.h"
+#include "LaneKernels.h" // For fitsInt32Lanes and the vector Philox
+#include "ThreadPool.h"
+
+/*
+ * Edge sweeps: the ruin probability at every house win probability of a grid, from one
+ * set of runs.
+ *
+ * Every engine decides bet i of run r by comparing the same 64-bit uniform U (word i of
+ * stream r, completed by its tie-break word; see Bernoulli.h) against T = floor(p * 2^64).
+ * So one U decides the bet for every p of a grid at once: the house wins at p exactly when
+ * U < T(p). Each run advances one walk per win probability, all drawn from the same
+ * stream, and each walk is exactly the run the regular engines simulate at that p. Under
+ * the same scenario key, a grid point equal to HOUSE_WIN_PROB reproduces the Monte Carlo
+ * ruin count run for run.
+ *
+ * The coupling is monotone: with the thresholds ascending, a walk at a higher p wins every
+ * bet a lower one wins, so it never falls below it, and the ruined walks are always those
+ * at the lowest win probabilities. Each run's ruin curve is a step down the grid, so the
+ * estimated curve is non-increasing, and neighbouring points differ only by the runs that
+ * actually separate them rather than by independent noise.
+ *
+ * The walks live in the lanes of a vector, one per win probability: a bet is one generator
+ * word broadcast, compared with every threshold at once, and one masked add. Up to a
+ * vector's width of grid points the cost per bet hardly depends on how many there are.
+ */
+
+/**
+ * @brief A grid of house win probabilities in ascending order, with their thresholds.
+ */
+struct EdgeGrid {
+    std::vector<double> probabilities;
+    std::vector<BernoulliThreshold> thresholds;
+
+    int size() const { return static_cast<int>(probabilities.size()); }
+};
+
+/**
+ * @brief count evenly spaced win probabilities from first to last (both included).
+ * @param first The lowest probability; with count 1, the only one.
+ * @param last The highest probability, at least first.
+ */
+inline EdgeGrid makeEdgeGrid(double first, double last, int count) {
+    EdgeGrid grid;
+    for (int k = 0; k < count; ++k) {
+        double probability = (k == count - 1 && count > 1) ? last
+            : first + (last - first) * static_cast<double>(k) / static_cast<double>(count > 1 ? count - 1 : 1);
+        grid.probabilities.push_back(probability);
+        grid.thresholds.push_back(makeBernoulliThreshold(probability));
+    }
+    return grid;
+}
+
+/**
+ * @brief Signature shared by the edge kernels: simulates one run at every win probability
+ * of a grid, from the run's one stream.
+ * @param streamKey The (master seed, scenario) key of the random streams.
+ * @param startUnits The starting bankroll in bet units.
+ * @param grid The win probabilities, ascending, at most MAX_EDGES of them.
+ * @param runIndex The index of this run, which selects its own random stream.
+ * @param finalUnits Receives the final bankroll in bet units at each win probability
+ * (below RUIN_THRESHOLD_UNITS means the house was ruined).
+ * @param lowestUnits If not null, receives the lowest bankroll in bet units each walk was
+ * at after any bet, up to its ruin (the largest int64 if there were no bets).
+ */
+typedef void (*EdgeRunKernel)(PhiloxKey streamKey, std::int64_t startUnits, long long numBets,
+    const EdgeGrid& grid, long long runIndex, std::int64_t* finalUnits, std::int64_t* lowestUnits);
+
+/**
+ * @brief Portable fallback: the walks one at a time, on 64-bit units. Produces
+ * bit-identical results to the vector kernels.
+ */
+inline void edgeRunScalar(PhiloxKey streamKey, std::int64_t startUnits, long long numBets,
+    const EdgeGrid& grid, long long runIndex, std::int64_t* finalUnits, std::int64_t* lowestUnits) {
+    const int edges = grid.size();
+    const std::uint64_t run = static_cast<std::uint64_t>(runIndex);
+    for (int e = 0; e < edges; ++e) {
+        finalUnits[e] = startUnits;
+        if (lowestUnits) lowestUnits[e] = std::numeric_limits<std::int64_t>::max();
+    }
+
+    // Walks below firstAlive are ruined, and stay where they were ruined (see above)
+    PhiloxStream stream(streamKey, run);
+    int firstAlive = 0;
+    for (long long i = 0; i < numBets && firstAlive < edges; ++i) {
+        std::uint32_t word = stream();
+        for (int e = firstAlive; e < edges; ++e) {
+            finalUnits[e] += houseWinsBet(grid.thresholds[e], word, streamKey, run, static_cast<std::uint64_t>(i)) ? 1 : -1;
+            if (lowestUnits && finalUnits[e] < lowestUnits[e]) lowestUnits[e] = finalUnits[e];
+        }
+        while (firstAlive < edges && finalUnits[firstAlive] < RUIN_THRESHOLD_UNITS) ++firstAlive;
+    }
+}
+
+#if CASINO_X86_SIMD
+
+/**
+ * @brief AVX2 kernel: 8 walks per register. The run's words come 32 at a time from an
+ * 8-lane Philox; each is broadcast against 8 thresholds, and lanes that hit ruin drop
+ * out of their group's "alive" mask and keep their ruined bankroll.
+ */
+CASINO_TARGET_AVX2 inline void edgeRunAvx2(PhiloxKey streamKey, std::int64_t startUnits, long long numBets,
+    const EdgeGrid& grid, long long runIndex, std::int64_t* finalUnits, std::int64_t* lowestUnits) {
+    const int edges = grid.size();
+    if (!fitsInt32Lanes(startUnits, numBets) || edges > MAX_EDGES) {
+        edgeRunScalar(streamKey, startUnits, numBets, grid, runIndex, finalUnits, lowestUnits);
+        return;
+    }
+    const int GROUP = 8;
+    const int groups = (edges + GROUP - 1) / GROUP;
+
+    // AVX2 only compares signed integers, so flip the sign bit on both sides.
+    // Lanes past the last win probability are never alive.
+    __m256i threshold[MAX_EDGES / GROUP], thresholdRaw[MAX_EDGES / GROUP], units[MAX_EDGES / GROUP], alive[MAX_EDGES / GROUP];
+    __m256i lowest[MAX_EDGES / GROUP];
+    for (int g = 0; g < groups; ++g) {
+        alignas(32) std::uint32_t hi[GROUP];
+        alignas(32) std::int32_t live[GROUP];
+        for (int k = 0; k < GROUP; ++k) {
+            int e = g * GROUP + k;
+            hi[k] = (e < edges) ? grid.thresholds[e].hi : 0;
+            live[k] = (e < edges) ? -1 : 0;
+        }
+        thresholdRaw[g] = _mm256_load_si256(reinterpret_cast<const __m256i*>(hi));
+        threshold[g] = _mm256_xor_si256(thresholdRaw[g], _mm256_set1_epi32(static_cast<int>(0x80000000u)));
+        alive[g] = _mm256_load_si256(reinterpret_cast<const __m256i*>(live));
+        units[g] = _mm256_set1_epi32(static_cast<int>(startUnits));
+        lowest[g] = _mm256_set1_epi32(INT32_MAX);
+    }
+    const __m256i signBit = _mm256_set1_epi32(static_cast<int>(0x80000000u));
+    const __m256i one = _mm256_set1_epi32(1);
+    const __m256i ruinThreshold = _mm256_set1_epi32(static_cast<int>(RUIN_THRESHOLD_UNITS));
+    const std::uint64_t run = static_cast<std::uint64_t>(runIndex);
+
+    // Groups below firstGroup are wholly ruined
+    int firstGroup = 0;
+    for (long long firstBet = 0; firstBet < numBets && firstGroup < groups; firstBet += 32) {
+        std::uint32_t blockLo[8], blockHi[8];
+        for (int b = 0; b < 8; ++b) {
+            std::uint64_t block = static_cast<std::uint64_t>(firstBet) / 4 + b;
+            blockLo[b] = static_cast<std::uint32_t>(block);
+            blockHi[b] = static_cast<std::uint32_t>(block >> 32);
+        }
+        __m256i blockWords[4] = {
+            _mm256_loadu_si256(reinterpret_cast<const __m256i*>(blockLo)),
+            _mm256_loadu_si256(reinterpret_cast<const __m256i*>(blockHi)),
+            _mm256_set1_epi32(static_cast<int>(static_cast<std::uint32_t>(run))),
+            _mm256_set1_epi32(static_cast<int>(static_cast<std::uint32_t>(run >> 32)))
+        };
+        philox4x32Avx2(blockWords, streamKey);
+        alignas(32) std::uint32_t words[4][8];   // words[j][b] is bet 4b + j
+        for (int j = 0; j < 4; ++j) {
+            _mm256_store_si256(reinterpret_cast<__m256i*>(words[j]), blockWords[j]);
+        }
+
+        long long betsHere = numBets - firstBet;
+        if (betsHere > 32) betsHere = 32;
+        for (int t = 0; t < betsHere && firstGroup < groups; ++t) {
+            const __m256i word = _mm256_set1_epi32(static_cast<int>(words[t % 4][t / 4]));
+            const __m256i flipped = _mm256_xor_si256(word, signBit);
+            for (int g = firstGroup; g < groups; ++g) {
+                __m256i win = _mm256_cmpgt_epi32(threshold[g], flipped);
+
+                // A word equal to a threshold's high word needs its low word to decide (rare)
+                int tiedMask = _mm256_movemask_ps(_mm256_castsi256_ps(_mm256_cmpeq_epi32(word, thresholdRaw[g])));
+                if (tiedMask != 0) {
+                    alignas(32) std::int32_t wins[GROUP];
+                    _mm256_store_si256(reinterpret_cast<__m256i*>(wins), win);
+                    std::uint32_t low = tieBreakWord(streamKey, run, static_cast<std::uint64_t>(firstBet + t));
+                    for (int k = 0; k < GROUP; ++k) {
+                        if ((tiedMask >> k) & 1) wins[k] = (low < grid.thresholds[g * GROUP + k].lo) ? -1 : 0;
+                    }
+                    win = _mm256_load_si256(reinterpret_cast<const __m256i*>(wins));
+                }
+
+                // win | 1 is -1 where the house wins and +1 where it loses, so subtracting it steps the walk
+                units[g] = _mm256_sub_epi32(units[g], _mm256_and_si256(alive[g], _mm256_or_si256(win, one)));
+                alive[g] = _mm256_andnot_si256(_mm256_cmpgt_epi32(ruinThreshold, units[g]), alive[g]);
+                if (lowestUnits) lowest[g] = _mm256_min_epi32(lowest[g], units[g]);
+            }
+            while (firstGroup < groups && _mm256_testz_si256(alive[firstGroup], alive[firstGroup])) ++firstGroup;
+        }
+    }
+
+    for (int g = 0; g < groups; ++g) {
+        alignas(32) std::int32_t lanes[GROUP], lows[GROUP];
+        _mm256_store_si256(reinterpret_cast<__m256i*>(lanes), units[g]);
+        _mm256_store_si256(reinterpret_cast<__m256i*>(lows), lowest[g]);
+        for (int k = 0; k < GROUP && g * GROUP + k < edges; ++k) {
+            finalUnits[g * GROUP + k] = lanes[k];
+            if (lowestUnits) lowestUnits[g * GROUP + k] = (lows[k] == INT32_MAX) ? std::numeric_limits<std::int64_t>::max() : lows[k];
+        }
+    }
+}
+
+/**
+ * @brief AVX-512 kernel: 16 walks per register, with the alive lanes in mask registers.
+ * The run's words come 64 at a time from a 16-lane Philox.
+ */
+CASINO_TARGET_AVX512 inline void edgeRunAvx512(PhiloxKey streamKey, std::int64_t startUnits, long long numBets,
+    const EdgeGrid& grid, long long runIndex, std::int64_t* finalUnits, std::int64_t* lowestUnits) {
+    const int edges = grid.size();
+    if (!fitsInt32Lanes(startUnits, numBets) || edges > MAX_EDGES) {
+        edgeRunScalar(streamKey, startUnits, numBets, grid, runIndex, finalUnits, lowestUnits);
+        return;
+    }
+    const int GROUP = 16;
+    const int groups = (edges + GROUP - 1) / GROUP;
+
+    // Lanes past the last win probability are never alive
+    __m512i threshold[MAX_EDGES / GROUP], units[MAX_EDGES / GROUP], lowest[MAX_EDGES / GROUP];
+    __mmask16 alive[MAX_EDGES / GROUP];
+    for (int g = 0; g < groups; ++g) {
+        alignas(64) std::uint32_t hi[GROUP];
+        unsigned live = 0;
+        for (int k = 0; k < GROUP; ++k) {
+            int e = g * GROUP + k;
+            hi[k] = (e < edges) ? grid.thresholds[e].hi : 0;
+            if (e < edges) live |= 1u << k;
+        }
+        threshold[g] = _mm512_load_si512(hi);
+        alive[g] = static_cast<__mmask16>(live);
+        units[g] = _mm512_set1_epi32(static_cast<int>(startUnits));
+        lowest[g] = _mm512_set1_epi32(INT32_MAX);
+    }
+    const __m512i one = _mm512_set1_epi32(1);
+    const __m512i minusOne = _mm512_set1_epi32(-1);
+    const __m512i ruinThreshold = _mm512_set1_epi32(static_cast<int>(RUIN_THRESHOLD_UNITS));
+    const std::uint64_t run = static_cast<std::uint64_t>(runIndex);
+
+    // Groups below firstGroup are wholly ruined
+    int firstGroup = 0;
+    for (long long firstBet = 0; firstBet < numBets && firstGroup < groups; firstBet += 64) {
+        std::uint32_t blockLo[16], blockHi[16];
+        for (int b = 0; b < 16; ++b) {
+            std::uint64_t block = static_cast<std::uint64_t>(firstBet) / 4 + b;
+            blockLo[b] = static_cast<std::uint32_t>(block);
+            blockHi[b] = static_cast<std::uint32_t>(block >> 32);
+        }
+        __m512i blockWords[4] = {
+            _mm512_loadu_si512(blockLo),
+            _mm512_loadu_si512(blockHi),
+            _mm512_set1_epi32(static_cast<int>(static_cast<std::uint32_t>(run))),
+            _mm512_set1_epi32(static_cast<int>(static_cast<std::uint32_t>(run >> 32)))
+        };
+        philox4x32Avx512(blockWords, streamKey);
+        alignas(64) std::uint32_t words[4][16];  // words[j][b] is bet 4b + j
+        for (int j = 0; j < 4; ++j) {
+            _mm512_store_si512(words[j], blockWords[j]);
+        }
+
+        long long betsHere = numBets - firstBet;
+        if (betsHere > 64) betsHere = 64;
+        for (int t = 0; t < betsHere && firstGroup < groups; ++t) {
+            const __m512i word = _mm512_set1_epi32(static_cast<int>(words[t % 4][t / 4]));
+            for (int g = firstGroup; g < groups; ++g) {
+                unsigned win = _mm512_cmplt_epu32_mask(word, threshold[g]);
+
+                // A word equal to a threshold's high word needs its low word to decide (rare)
+                unsigned tiedMask = _mm512_cmpeq_epu32_mask(word, threshold[g]);
+                if (tiedMask != 0) {
+                    std::uint32_t low = tieBreakWord(streamKey, run, static_cast<std::uint64_t>(firstBet + t));
+                    for (int k = 0; k < GROUP; ++k) {
+                        if ((tiedMask >> k) & 1) {
+                            win = (low < grid.thresholds[g * GROUP + k].lo) ? (win | (1u << k)) : (win & ~(1u << k));
+                        }
+                    }
+                }
+
+                __m512i step = _mm512_mask_blend_epi32(static_cast<__mmask16>(win), minusOne, one);
+                units[g] = _mm512_mask_add_epi32(units[g], alive[g], units[g], step);
+                alive[g] = static_cast<__mmask16>(alive[g] & _mm512_cmpge_epi32_mask(units[g], ruinThreshold));
+                // (Zero-masked over every lane: the plain form trips GCC 12's bug 105593, see mulhilo32Avx512)
+                if (lowestUnits) lowest[g] = _mm512_maskz_min_epi32(0xFFFF, lowest[g], units[g]);
+            }
+            while (firstGroup < groups && alive[firstGroup] == 0) ++firstGroup;
+        }
+    }
+
+    for (int g = 0; g < groups; ++g) {
+        alignas(64) std::int32_t lanes[GROUP], lows[GROUP];
+        _mm512_store_si512(lanes, units[g]);
+        _mm512_store_si512(lows, lowest[g]);
+        for (int k = 0; k < GROUP && g * GROUP + k < edges; ++k) {
+            finalUnits[g * GROUP + k] = lanes[k];
+            if (lowestUnits) lowestUnits[g * GROUP + k] = (lows[k] == INT32_MAX) ? std::numeric_limits<std::int64_t>::max() : lows[k];
+        }
+    }
+}
+
+#endif // CASINO_X86_SIMD
+
+/**
+ * @brief Picks the edge kernel for a SIMD level. Levels the build cannot target fall back to scalar.
+ */
+inline EdgeRunKernel selectEdgeRunKernel(SimdLevel level) {
+#if CASINO_X86_SIMD
+    if (level == SimdLevel::Avx512) return edgeRunAvx512;
+    if (level == SimdLevel::Avx2) return edgeRunAvx2;
+#else
+    (void)level;
+#endif
+    return edgeRunScalar;
+}
+
+/**
+ * @brief Simulates totalRuns runs at every win probability of the grid, sharded across the pool.
+ * Ruins are integer counts, so the totals do not depend on the thread count.
+ * @return The number of runs ruined at each win probability.
+ */
+inline std::vector<long long> simulateEdgeSweep(ThreadPool& pool, EdgeRunKernel edgeRun, PhiloxKey streamKey, std::int64_t startUnits,
+    long long numBets, const EdgeGrid& grid, long long totalRuns, long long runsPerChunk) {
+    const int edges = grid.size();
+
+    // Each chunk counts locally and adds to its thread's tally once
+    std::vector<CacheLinePadded<std::vector<long long>>> ruinsByThread(pool.size());
+    for (CacheLinePadded<std::vector<long long>>& slot : ruinsByThread) {
+        slot.value.assign(static_cast<std::size_t>(edges), 0);
+    }
+    pool.parallelFor(totalRuns, runsPerChunk, [&](unsigned threadIndex, long long begin, long long end) {
+        long long ruins[MAX_EDGES] = {};
+        std::int64_t finalUnits[MAX_EDGES];
+        for (long long i = begin; i < end; ++i) {
+            edgeRun(streamKey, startUnits, numBets, grid, i, finalUnits, nullptr);
+            for (int e = 0; e < edges; ++e) {
+                if (finalUnits[e] < RUIN_THRESHOLD_UNITS) ruins[e]++;
+            }
+        }
+        std::vector<long long>& tally = ruinsByThread[threadIndex].value;
+        for (int e = 0; e < edges; ++e) tally[static_cast<std::size_t>(e)] += ruins[e];
+    });
+
+    std::vector<long long> ruinCounts(static_cast<std::size_t>(edges), 0);
+    for (const CacheLinePadded<std::vector<long long>>& slot : ruinsByThread) {
+        for (int e = 0; e < edges; ++e) ruinCounts[static_cast<std::size_t>(e)] += slot.value[static_cast<std::size_t>(e)];
+    }
+    return ruinCounts;
+}
+
+/*
+ * Surfaces: the ruin probability over every win probability of a grid and every bankroll
+ * of a sweep, from one set of runs.
+ *
+ * As in a bankroll sweep (see Sweep.h), a start of s units is ruined exactly when its walk
+ * falls s units at some bet. So each run's walks start from the largest bankroll S and keep
+ * their lowest point L: the run is ruined from s at that win probability exactly when
+ * L <= S - s. A walk ruined from S stops there, and is ruined from every smaller start too.
+ * The bankrolls ruined at one win probability are then the smallest ones, up to S - L, so
+ * each walk adds one count at its cut-off and the ruin counts of every bankroll are the
+ * running totals. A run costs its bets times the edges, however many bankrolls there are.
+ */
+
+/**
+ * @brief The ruin counts of a surface: a dense bankroll-by-win-probability matrix.
+ */
+struct SurfaceResults {
+    std::size_t edges = 0;
+    std::vector<long long> ruinCounts; // ruinCounts[bankroll * edges + e], bankrolls in the caller's order
+};
+
+/**
+ * @brief Simulates totalRuns runs at every win probability of the grid, from the largest of
+ * startUnits, and counts the runs ruined from each start. Counts are integers, so they do
+ * not depend on the thread count.
+ * @param startUnits The starting bankroll of each scenario, in bet units, in any order.
+ */
+inline SurfaceResults simulateEdgeSurface(ThreadPool& pool, EdgeRunKernel edgeRun, PhiloxKey streamKey,
+    const std::vector<std::int64_t>& startUnits, long long numBets, const EdgeGrid& grid, long long totalRuns, long long runsPerChunk) {
+    const std::size_t edges = static_cast<std::size_t>(grid.size());
+    const std::size_t bankrolls = startUnits.size();
+    SurfaceResults surface;
+    surface.edges = edges;
+    surface.ruinCounts.assign(bankrolls * edges, 0);
+    if (bankrolls == 0) return surface;
+
+    std::vector<std::int64_t> ascending(startUnits);
+    std::sort(ascending.begin(), ascending.end());
+    const std::int64_t largest = ascending.back();
+
+    // cutoffs[e * (bankrolls + 1) + k]: runs ruined at win probability e from exactly the k smallest starts.
+    // Each chunk counts into its own array and adds to its thread's tally once, as in simulateEdgeSweep
+    const std::size_t cells = edges * (bankrolls + 1);
+    std::vector<CacheLinePadded<std::vector<long long>>> cutoffsByThread(pool.size());
+    for (CacheLinePadded<std::vector<long long>>& slot : cutoffsByThread) {
+        slot.value.assign(cells, 0);
+    }
+    pool.parallelFor(totalRuns, runsPerChunk, [&](unsigned threadIndex, long long begin, long long end) {
+        std::vector<long long> cutoffs(cells, 0);
+        std::int64_t finalUnits[MAX_EDGES], lowestUnits[MAX_EDGES];
+        for (long long i = begin; i < end; ++i) {
+            edgeRun(streamKey, largest, numBets, grid, i, finalUnits, lowestUnits);
+            for (std::size_t e = 0; e < edges; ++e) {
+                // (No bets leaves the lowest point at the int64 maximum, so nothing is ruined)
+                std::int64_t deepest = largest - lowestUnits[e];
+                std::size_t ruined = static_cast<std::size_t>(std::upper_bound(ascending.begin(), ascending.end(), deepest) - ascending.begin());
+                cutoffs[e * (bankrolls + 1) + ruined]++;
+            }
+        }
+        std::vector<long long>& tally = cutoffsByThread[threadIndex].value;
+        for (std::size_t k = 0; k < cells; ++k) tally[k] += cutoffs[k];
+    });
+
+    std::vector<long long> cutoffs(cells, 0);
+    for (const CacheLinePadded<std::vector<long long>>& slot : cutoffsByThread) {
+        for (std::size_t k = 0; k < cutoffs.size(); ++k) cutoffs[k] += slot.value[k];
+    }
+
+    // The start in ascending place j is ruined by every run whose cut-off is past j
+    std::vector<long long> ascendingCounts(bankrolls * edges, 0);
+    for (std::size_t e = 0; e < edges; ++e) {
+        long long ruins = 0;
+        for (std::size_t j = bankrolls; j-- > 0;) {
+            ruins += cutoffs[e * (bankrolls + 1) + j + 1];
+            ascendingCounts[j * edges + e] = ruins;
+        }
+    }
+    for (std::size_t b = 0; b < bankrolls; ++b) {
+        std::size_t j = static_cast<std::size_t>(std::lower_bound(ascending.begin(), ascending.end(), startUnits[b]) - ascending.begin());
+        for (std::size_t e = 0; e < edges; ++e) {
+            surface.ruinCounts[b * edges + e] = ascendingCounts[j * edges + e];
+        }
+    }
+    return surface;
+}
@@ -0,0 +1,78 @@
+#pragma once
+
+/**
+ * @brief The ways a batch of runs can be simulated. All engines model the same game.
+ */
+enum class SimulationEngine {
+    Reference,  // simulateSingleRun, one run and one bet at a time, bankroll in dollars
+    Lattice,    // simulateLatticeRun, one run at a time, bankroll in integer bet units
+    Lanes,      // Lane-parallel kernel on integer bet units (AVX-512 / AVX2 / scalar, picked at runtime)
+    Block,      // simulateBlockRun, one run at a time, 8 bets per table lookup
+    Bridge      // BridgeSampler, final bankroll and ruin drawn jointly in O(log n) per run
+};
+
+/**
+ * @brief A printable name for an engine, used in the simulation header.
+ */
+inline const char* engineName(SimulationEngine engine) {
+    switch (engine) {
+    case SimulationEngine::Lattice: return "Integer lattice";
+    case SimulationEngine::Lanes: return "Lane-parallel";
+    case SimulationEngine::Block: return "Block-stepping";
+    case SimulationEngine::Bridge: return "Bridge sampler";
+    default: return "Reference";
+    }
+}
+
+// The most win probabilities one edge sweep can hold (four AVX-512 vectors of walks; see EdgeSweep.h)
+const int MAX_EDGES = 64;
+
+/**
+ * @brief How a scenario's ruin probability is obtained.
+ */
+enum class EvaluationMode {
+    MonteCarlo, // Simulate TOTAL_RUNS runs with the selected engine
+    Exact,      // solveFiniteHorizon, the exact distribution with no sampling error
+    ClosedForm, // closedFormDistribution, the same exact numbers by the reflection principle
+    Importance, // Simulate with the win probability tilted towards ruin, and reweight each run
+    Sweep,      // Simulate each walk once and answer every bankroll from its running minimum
+    Passage,    // Monte Carlo that also records the bet at which each run was ruined
+    Edges,      // Simulate each run once at every house win probability of a grid, from one stream
+    Surface,    // Edges for every bankroll at once, from each walk's running minimum
+    MinBankroll, // The smallest bankroll that meets a target ruin probability, from one set of walks
+    Infinite,   // infiniteHorizonRuinProbability, the exact probability of ever being ruined
+    Diffusion   // diffusionRuinProbability, the Brownian first-passage approximation
+};
+
+/**
+ * @brief A printable name for an evaluation mode, used in the simulation header.
+ */
+inline const char* evaluationModeName(EvaluationMode mode) {
+    switch (mode) {
+    case EvaluationMode::Exact: return "Exact (finite-horizon dynamic programming)";
+    case EvaluationMode::ClosedForm: return "Exact (closed form, reflection principle)";
+    case EvaluationMode::Infinite: return "Exact (infinite horizon, absorbing chain)";
+    case EvaluationMode::Diffusion: return "Diffusion approximation (inverse-Gaussian first passage)";
+    case EvaluationMode::Importance: return "Importance sampling";
+    case EvaluationMode::Sweep: return "Sweep (every bankroll from one set of walks)";
+    case EvaluationMode::Passage: return "First passage (time to ruin and hazard curve)";
+    case EvaluationMode::Edges: return "Edge sweep (every house win probability from the same runs)";
+    case EvaluationMode::Surface: return "Surface (every house win probability and bankroll from one set of runs)";
+    case EvaluationMode::MinBankroll: return "Bankroll search (smallest bankroll for a target ruin probability)";
+    default: return "Monte Carlo";
+    }
+}
+
+/**
+ * @brief True for the modes that compute probabilities exactly instead of simulating runs.
+ */
+inline bool isExactMode(EvaluationMode mode) {
+    return mode == EvaluationMode::Exact || mode == EvaluationMode::ClosedForm || mode == EvaluationMode::Infinite;
+}
+
+/**
+ * @brief True for the modes that compute probabilities, exactly or not, instead of simulating runs.
+ */
+inline bool isComputedMode(EvaluationMode mode) {
+    return isExactMode(mode) || mode == EvaluationMode::Diffusion;
+}
@@ -0,0 +1,184 @@
+#pragma once
+
+#include <cmath>        // For pow
+#include <cstdint>
+#include <iomanip>      // For setw and setprecision
+#include <iostream>
+#include <vector>
+
+/*
+ * First-passage times: the bet at which each ruined run was ruined.
+ *
+ * A run of n bets is ruined within its first t bets exactly when its first-passage time
+ * is at most t, so the distribution of passage times is the ruin probability of every
+ * shorter horizon at once: P(ruin within t bets) = (runs ruined by bet t) / (all runs).
+ * One pass at BETS_PER_RUN answers every horizon up to BETS_PER_RUN.
+ *
+ * The engines already know the ruin bet when they stop a run, so recording it costs one
+ * store and one increment per ruined run, and nothing per bet.
+ */
+
+/**
+ * @brief A streaming histogram of first-passage times, in log-spaced buckets.
+ *
+ * Times below SUB_BUCKETS have a bucket each; above that every power of two is split
+ * into SUB_BUCKETS equal buckets, so a bucket is never wider than 1 / SUB_BUCKETS of the
+ * times in it (25%). A million-bet horizon needs 76 counters.
+ */
+class PassageHistogram {
+public:
+    static const int SUB_BUCKET_BITS = 2;
+    static const long long SUB_BUCKETS = 1LL << SUB_BUCKET_BITS;
+
+    PassageHistogram() : numBets(0), ruined(0), totalBetsToRuin(0) {}
+
+    /**
+     * @param numBets The number of bets in a run, the longest possible passage time.
+     */
+    explicit PassageHistogram(long long numBets)
+        : numBets(numBets), ruined(0), totalBetsToRuin(0), counts(bucketIndex(numBets) + 1, 0) {}
+
+    /**
+     * @brief Folds in one ruined run.
+     * @param ruinBet The bet (1 to numBets) after which the run was ruined.
+     */
+    void add(long long ruinBet) {
+        counts[bucketIndex(ruinBet)]++;
+        ruined++;
+        totalBetsToRuin += ruinBet;
+    }
+
+    /**
+     * @brief Folds in another histogram of the same horizon (e.g. another thread's).
+     * Counts are integers, so the merged result does not depend on the merge order.
+     */
+    void merge(const PassageHistogram& other) {
+        if (counts.empty()) {
+            *this = other;
+            return;
+        }
+        for (std::size_t b = 0; b < other.counts.size(); ++b) {
+            counts[b] += other.counts[b];
+        }
+        ruined += other.ruined;
+        totalBetsToRuin += other.totalBetsToRuin;
+    }
+
+    long long ruinCount() const { return ruined; }
+    long long horizon() const { return numBets; }
+    std::size_t bucketCount() const { return counts.size(); }
+    long long bucketRuins(std::size_t b) const { return counts[b]; }
+
+    double meanBetsToRuin() const {
+        return (ruined > 0) ? static_cast<double>(totalBetsToRuin) / static_cast<double>(ruined) : 0.0;
+    }
+
+    /**
+     * @brief The first passage time that falls in bucket b.
+     */
+    static long long bucketFirstBet(std::size_t b) {
+        long long index = static_cast<long long>(b);
+        if (index < SUB_BUCKETS) return index;
+        long long octave = index / SUB_BUCKETS - 1;
+        return (SUB_BUCKETS + index % SUB_BUCKETS) << octave;
+    }
+
+    /**
+     * @brief The last passage time that falls in bucket b (clipped to the horizon).
+     */
+    long long bucketLastBet(std::size_t b) const {
+        long long last = bucketFirstBet(b + 1) - 1;
+        return (last < numBets) ? last : numBets;
+    }
+
+    /**
+     * @brief The bucket of a passage time (at least 1).
+     */
+    static std::size_t bucketIndex(long long bets) {
+        if (bets < SUB_BUCKETS) return static_cast<std::size_t>(bets);
+        int highBit = 0;
+        while ((bets >> (highBit + 1)) != 0) ++highBit;
+        int octave = highBit - SUB_BUCKET_BITS;
+        return static_cast<std::size_t>((octave + 1) * SUB_BUCKETS + ((bets >> octave) - SUB_BUCKETS));
+    }
+
+    /**
+     * @brief Writes the exact state to a checkpoint (see Checkpoint.h).
+     */
+    template <typename Writer>
+    void save(Writer& out) const {
+        out.putInt(numBets);
+        out.putInt(ruined);
+        out.putInt(totalBetsToRuin);
+        out.putInt(static_cast<std::int64_t>(counts.size()));
+        for (long long count : counts) out.putInt(count);
+    }
+
+    /**
+     * @brief Reads back a state written by save.
+     * @return false if the checkpoint was cut short.
+     */
+    template <typename Reader>
+    bool load(Reader& in) {
+        numBets = in.getInt();
+        ruined = in.getInt();
+        totalBetsToRuin = in.getInt();
+        counts.assign(in.getCount(), 0);
+        for (long long& count : counts) count = in.getInt();
+        return in.ok();
+    }
+
+private:
+    long long numBets;
+    long long ruined;
+    long long totalBetsToRuin;
+    std::vector<long long> counts;  // counts[b]: runs ruined at a bet in bucket b
+};
+
+/**
+ * @brief Prints the time-to-ruin distribution and the hazard curve of a set of runs.
+ *
+ * For every bucket of passage times: the runs ruined in it, the ruin probability for a
+ * horizon ending at the bucket's last bet (the ruin-vs-horizon curve), and the hazard,
+ * the chance per bet of being ruined given survival so far, averaged geometrically over
+ * the bucket. (Ruin is only possible every other bet, on the parity of the start, so the
+ * per-bet hazard is an average over both.)
+ * @param passage The passage times of the ruined runs.
+ * @param totalRuns All the runs simulated, ruined or not.
+ */
+inline void printPassageTable(const PassageHistogram& passage, long long totalRuns) {
+    if (passage.ruinCount() == 0) {
+        std::cout << "    No ruined runs: no first-passage times to chart." << std::endl;
+        return;
+    }
+
+    std::cout << "    --- Time to Ruin (" << passage.ruinCount() << " ruined runs, mean "
+        << std::fixed << std::setprecision(1) << passage.meanBetsToRuin() << " bets) ---" << std::endl;
+    std::cout << "    " << std::setw(25) << "Ruined at bet" << " | " << std::setw(10) << "Runs" << " | "
+        << std::setw(18) << "Ruin by then (%)" << " | " << "Hazard per bet" << std::endl;
+    std::cout << "    ------------------------------------------------------------------------" << std::endl;
+
+    long long ruinedBefore = 0;
+    for (std::size_t b = 1; b < passage.bucketCount(); ++b) {
+        long long runs = passage.bucketRuins(b);
+        if (runs == 0) continue;
+
+        long long firstBet = PassageHistogram::bucketFirstBet(b);
+        long long lastBet = passage.bucketLastBet(b);
+        long long ruinedAfter = ruinedBefore + runs;
+
+        // Per-bet hazard h with (1 - h)^width = S(last) / S(first - 1)
+        double survivalBefore = static_cast<double>(totalRuns - ruinedBefore);
+        double survivalAfter = static_cast<double>(totalRuns - ruinedAfter);
+        double width = static_cast<double>(lastBet - firstBet + 1);
+        double hazard = 1.0 - std::pow(survivalAfter / survivalBefore, 1.0 / width);
+
+        std::cout << "    " << std::setw(11) << firstBet << " - " << std::setw(11) << lastBet << " | "
+            << std::setw(10) << runs << " | "
+            << std::setw(18) << std::setprecision(5) << (100.0 * static_cast<double>(ruinedAfter) / static_cast<double>(totalRuns)) << " | "
+            << std::scientific << std::setprecision(3) << hazard << std::fixed << std::endl;
+        ruinedBefore = ruinedAfter;
+    }
+    std::cout << std::fixed << std::setprecision(5); // Reset precision for main loop
+    std::cout << "    ------------------------------------------------------------------------" << std::endl;
+}
@@ -0,0 +1,179 @@
+#pragma once
+
+#include <cstdint>
+#include <vector>
+
+#include "Lattice.h"
+
+/**
+ * @brief A streaming histogram of final bankrolls, with one counter per lattice position.
+ *
+ * A surviving run of n bets ends at start + n - 2 * (losses), so its bankroll lies in
+ * [start - n, start + n] with the parity of start + n. Those n + 1 positions are known
+ * before any run is simulated, so a run is folded in with one array increment as soon as
+ * it finishes, and no vector of every run's result ever exists. Memory is n + 1 counters
+ * per thread (101 for the Source.cpp scenario), whatever the number of runs.
+ *
+ * Because every position has its own counter, the printed histogram is still binned
+ * exactly, over the range the survivors actually reached.
+ */
+class LatticeHistogram {
+public:
+    LatticeHistogram() : lowestUnits(0), ruined(0), survivors(0) {}
+
+    /**
+     * @param startUnits The starting bankroll in bet units (see makeLatticeScenario).
+     * @param numBets The number of bets in a run.
+     */
+    LatticeHistogram(std::int64_t startUnits, long long numBets)
+        : lowestUnits(startUnits - numBets), ruined(0), survivors(0), counts(static_cast<std::size_t>(numBets + 1), 0) {}
+
+    /**
+     * @brief Folds in the final bankroll (in bet units) of one run.
+     */
+    void add(std::int64_t units) {
+        if (units < RUIN_THRESHOLD_UNITS) {
+            ruined++;
+            return;
+        }
+        counts[static_cast<std::size_t>((units - lowestUnits) / 2)]++;
+        survivors++;
+    }
+
+    /**
+     * @brief Folds in another histogram of the same scenario (e.g. another thread's).
+     */
+    void merge(const LatticeHistogram& other) {
+        if (counts.empty()) {
+            *this = other;
+            return;
+        }
+        for (std::size_t k = 0; k < other.counts.size(); ++k) {
+            counts[k] += other.counts[k];
+        }
+        ruined += other.ruined;
+        survivors += other.survivors;
+    }
+
+    long long ruinCount() const { return ruined; }
+    long long survivorCount() const { return survivors; }
+
+    /**
+     * @brief The lattice position of weights()[0].
+     */
+    std::int64_t lowestPosition() const { return lowestUnits; }
+
+    /**
+     * @brief The surviving run count at every lattice position from lowestPosition() up,
+     * in the form binLatticeWeights takes (positions of the other parity are zero).
+     */
+    std::vector<double> weights() const {
+        std::vector<double> result(counts.empty() ? 0 : 2 * counts.size() - 1, 0.0);
+        for (std::size_t k = 0; k < counts.size(); ++k) {
+            result[2 * k] = static_cast<double>(counts[k]);
+        }
+        return result;
+    }
+
+    /**
+     * @brief Writes the exact state to a checkpoint (see Checkpoint.h).
+     */
+    template <typename Writer>
+    void save(Writer& out) const {
+        out.putInt(lowestUnits);
+        out.putInt(ruined);
+        out.putInt(survivors);
+        out.putInt(static_cast<std::int64_t>(counts.size()));
+        for (long long count : counts) out.putInt(count);
+    }
+
+    /**
+     * @brief Reads back a state written by save.
+     * @return false if the checkpoint was cut short.
+     */
+    template <typename Reader>
+    bool load(Reader& in) {
+        lowestUnits = in.getInt();
+        ruined = in.getInt();
+        survivors = in.getInt();
+        counts.assign(in.getCount(), 0);
+        for (long long& count : counts) count = in.getInt();
+        return in.ok();
+    }
+
+private:
+    std::int64_t lowestUnits;       // start - numBets, the lowest position a run can end at
+    long long ruined;
+    long long survivors;
+    std::vector<long long> counts;  // counts[k]: survivors that ended at lowestUnits + 2k
+};
+
+/**
+ * @brief Final bankrolls gathered into equal-width dollar ranges, ready to print or store.
+ * weights[i] covers [minBankroll + i * binWidth, minBankroll + (i + 1) * binWidth).
+ */
+struct HistogramBins {
+    double minBankroll = 0.0;    // Lowest bankroll that carries weight
+    double maxBankroll = 0.0;    // Highest bankroll that carries weight
+    double binWidth = 0.0;
+    double totalWeight = 0.0;    // Surviving runs, or survival probability
+    double maxBinWeight = 0.0;   // For scaling a chart
+    std::vector<double> weights; // Empty when nothing survived
+
+    bool empty() const { return weights.empty(); }
+};
+
+/**
+ * @brief Bins weights given on the lattice into numBins dollar ranges.
+ * weights[k] is how much of the outcome ends at lowestUnits + k bet units: a run count for
+ * a simulation, or a probability for the exact solver. Binning is done on the integer
+ * lattice, so every position lands in exactly the right bin; positions are converted back
+ * to dollars only for the bin edges. Only positions that carry weight set the range.
+ * @param lowestUnits The lattice position of weights[0].
+ * @param weights The weight of every surviving lattice position, from lowestUnits up.
+ * @param lattice The scenario's lattice, used to convert to dollars.
+ * @param numBins The number of ranges to create.
+ */
+inline HistogramBins binLatticeWeights(std::int64_t lowestUnits, const std::vector<double>& weights, const LatticeScenario& lattice, int numBins) {
+    HistogramBins result;
+
+    std::size_t first = 0;
+    while (first < weights.size() && weights[first] <= 0.0) ++first;
+    std::size_t last = weights.size();
+    while (last > first && weights[last - 1] <= 0.0) --last;
+    if (first == last) return result;
+
+    std::int64_t minUnits = lowestUnits + static_cast<std::int64_t>(first);
+    std::int64_t maxUnits = lowestUnits + static_cast<std::int64_t>(last - 1);
+    result.minBankroll = unitsToDollars(lattice, minUnits);
+    result.maxBankroll = unitsToDollars(lattice, maxUnits);
+
+    // A fixed array of bins
+    result.weights.assign(static_cast<std::size_t>(numBins), 0.0);
+    result.binWidth = (result.maxBankroll - result.minBankroll) / numBins;
+
+    // Handle the case where min == max (all survivors have the same bankroll)
+    if (result.binWidth == 0) {
+        // Avoid division by zero if all values are identical
+        result.binWidth = 100.0;
+    }
+
+    std::int64_t unitRange = maxUnits - minUnits;
+    for (std::size_t k = first; k < last; ++k) {
+        std::int64_t units = lowestUnits + static_cast<std::int64_t>(k);
+
+        // Find the bin this bankroll belongs to, in exact integer arithmetic.
+        // The max value lands exactly on the upper edge, so it goes in the last bin.
+        int binIndex = 0;
+        if (unitRange > 0) {
+            binIndex = static_cast<int>((units - minUnits) * numBins / unitRange);
+            if (binIndex == numBins) binIndex = numBins - 1;
+        }
+
+        double& bin = result.weights[static_cast<std::size_t>(binIndex)];
+        bin += weights[k];
+        result.totalWeight += weights[k];
+        if (bin > result.maxBinWeight) result.maxBinWeight = bin;
+    }
+    return result;
+}
@@ -0,0 +1,76 @@
+#pragma once
+
+#include <cmath>        // For exp, log and sqrt
+#include <cstdint>
+
+#include "Lattice.h"
+
+/*
+ * Importance sampling for rare ruin.
+ *
+ * When the house has the edge (p > 1/2), ruin needs a long run of bad luck, and with
+ * large bankrolls plain simulation sees no ruins at all. Instead the runs are simulated
+ * with the win probability tilted to p' = q = 1 - p, under which ruin is the typical
+ * outcome, and every ruined run is reweighted by its likelihood ratio.
+ *
+ * A run with W wins and L losses has likelihood ratio (p/p')^W (q/q')^L. With p' = q
+ * this is (q/p)^(L - W), and L - W is just how far the bankroll fell, start - final.
+ * So the weight depends only on where the run ended, the kernels need no changes
+ * (only a different threshold), and every ruined run ends exactly one unit below the
+ * threshold, so they all carry the same weight (q/p)^d. This is the exponential tilt
+ * that is asymptotically optimal for the ruin event (Siegmund, 1976): the relative
+ * error stays bounded however rare ruin is.
+ */
+
+/**
+ * @brief The win probability to simulate with: the loss probability when the house has
+ * the edge, and p itself otherwise. A start below one bet is not tilted either: it is
+ * ruined with probability at least q, and its ruined runs can end at two different units.
+ */
+inline double tiltedWinProbability(double houseWinProb, std::int64_t startUnits) {
+    if (startUnits < RUIN_THRESHOLD_UNITS) return houseWinProb;
+    return (houseWinProb > 0.5) ? 1.0 - houseWinProb : houseWinProb;
+}
+
+/**
+ * @brief An unbiased ruin probability estimate and its relative standard error.
+ */
+struct RuinEstimate {
+    double probability;
+    double relativeError; // Standard error / estimate; infinite when no run was ruined
+    double weight;        // The likelihood ratio every ruined run carries: probability / ruin fraction
+};
+
+/**
+ * @brief The likelihood-ratio weight (p'/p)^(start - final) that every ruined run simulated
+ * at tiltedWinProbability carries, since they all end just below the threshold.
+ * 1 when the runs are not tilted.
+ */
+inline double importanceWeight(std::int64_t startUnits, double houseWinProb) {
+    const double tilted = tiltedWinProbability(houseWinProb, startUnits);
+    if (tilted == houseWinProb) return 1.0;
+    std::int64_t drop = startUnits - (RUIN_THRESHOLD_UNITS - 1);
+    return std::exp(static_cast<double>(drop) * std::log(tilted / houseWinProb));
+}
+
+/**
+ * @brief Turns the ruin count of runs simulated at tiltedWinProbability into an estimate
+ * of the ruin probability at houseWinProb.
+ * @param tiltedRuinCount How many of the tilted runs were ruined.
+ * @param totalRuns How many tilted runs were simulated.
+ * @param startUnits The starting bankroll in bet units (see makeLatticeScenario).
+ * @param houseWinProb The real probability (0.0 to 1.0) that the house wins a single bet.
+ */
+inline RuinEstimate importanceSamplingEstimate(long long tiltedRuinCount, long long totalRuns, std::int64_t startUnits, double houseWinProb) {
+    RuinEstimate estimate;
+    const double weight = importanceWeight(startUnits, houseWinProb);
+
+    // The estimate is weight * (ruin fraction), a scaled binomial proportion
+    double fraction = static_cast<double>(tiltedRuinCount) / static_cast<double>(totalRuns);
+    estimate.probability = weight * fraction;
+    estimate.weight = weight;
+    estimate.relativeError = (tiltedRuinCount > 0)
+        ? std::sqrt((1.0 - fraction) / (fraction * static_cast<double>(totalRuns)))
+        : HUGE_VAL;
+    return estimate;
+}
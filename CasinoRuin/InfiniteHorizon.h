@@ -0,0 +1,171 @@
+#pragma once
+
+#include <cmath>        // For pow and fabs
+#include <cstdint>
+#include <vector>
+
+#include "Lattice.h"
+
+/*
+ * The probability of ever being ruined, with no limit on the number of bets.
+ *
+ * For the fixed-bet game the answer is the classic one: from s units above ruin the
+ * house is ruined with probability (q/p)^s when p > q, and surely otherwise. Setting
+ * BETS_PER_RUN huge only approaches that number, at the cost of simulating every bet.
+ *
+ * A game that pays more than one bet unit at a time is described by its payout table:
+ * how many units the house wins (or pays, if negative) on a bet, and how likely each
+ * outcome is. Its ruin probabilities r(u) solve the absorbing chain
+ *     r(u) = sum over outcomes of P(d) r(u + d),   r(u) = 1 below RUIN_THRESHOLD_UNITS,
+ * and r(u) -> 0 as u grows when the drift favours the house. solveInfiniteHorizon cuts
+ * the chain at a bankroll M (r = 0 above it), which makes it a banded linear system of
+ * M unknowns with one band per outcome, and solves it by banded elimination in
+ * O(M * band width^2). M is doubled until the start's probability stops changing, so
+ * the cut costs nothing measurable. The matrix is I minus a substochastic matrix, so
+ * elimination needs no pivoting and keeps the band.
+ */
+
+/**
+ * @brief One outcome of a bet: the house wins units bet units (pays, if negative).
+ */
+struct PayoutOutcome {
+    std::int64_t units;
+    double probability;
+};
+
+typedef std::vector<PayoutOutcome> PayoutTable;
+
+/**
+ * @brief The fixed-bet game: the house wins one unit with houseWinProb, else pays one.
+ */
+inline PayoutTable evenMoneyTable(double houseWinProb) {
+    return PayoutTable{ { 1, houseWinProb }, { -1, 1.0 - houseWinProb } };
+}
+
+/**
+ * @brief The exact infinite-horizon ruin probability of the fixed-bet game.
+ * @param startUnits The starting bankroll in bet units (see makeLatticeScenario).
+ * @param houseWinProb The probability (0.0 to 1.0) that the house wins a single bet.
+ */
+inline double evenMoneyInfiniteRuinProbability(std::int64_t startUnits, double houseWinProb) {
+    const double p = houseWinProb;
+    const double q = 1.0 - houseWinProb;
+    std::int64_t distance = startUnits - RUIN_THRESHOLD_UNITS + 1;
+    if (distance >= 1) {
+        return (p > q) ? std::pow(q / p, static_cast<double>(distance)) : 1.0;
+    }
+
+    // A start below one bet still plays its first bet, like the simulation
+    if (distance < 0) return 1.0;
+    return q + p * evenMoneyInfiniteRuinProbability(startUnits + 1, houseWinProb);
+}
+
+/**
+ * @brief Solves the cut chain of a payout table on bankrolls RUIN_THRESHOLD_UNITS to
+ * RUIN_THRESHOLD_UNITS + states - 1 by banded elimination.
+ * @return r(u) for each of those bankrolls, in order.
+ */
+inline std::vector<double> solveCutChain(const PayoutTable& table, std::int64_t states) {
+    std::int64_t below = 0; // Largest loss, the band below the diagonal
+    std::int64_t above = 0; // Largest win, the band above it
+    for (const PayoutOutcome& outcome : table) {
+        if (-outcome.units > below) below = -outcome.units;
+        if (outcome.units > above) above = outcome.units;
+    }
+    const std::int64_t width = below + above + 1;
+
+    // Row i is bankroll RUIN_THRESHOLD_UNITS + i; its entry for column j is band[i * width + j - i + below]
+    std::vector<double> band(static_cast<std::size_t>(states * width), 0.0);
+    std::vector<double> ruin(static_cast<std::size_t>(states), 0.0);
+    for (std::int64_t i = 0; i < states; ++i) {
+        double* row = &band[static_cast<std::size_t>(i * width)];
+        row[below] = 1.0;
+        for (const PayoutOutcome& outcome : table) {
+            std::int64_t next = i + outcome.units;
+            if (next < 0) ruin[static_cast<std::size_t>(i)] += outcome.probability;
+            else if (next < states) row[next - i + below] -= outcome.probability;
+        }
+    }
+
+    // Forward elimination within the band
+    for (std::int64_t k = 0; k < states; ++k) {
+        const double* pivotRow = &band[static_cast<std::size_t>(k * width)];
+        const double pivot = pivotRow[below];
+        const std::int64_t lastRow = (k + below < states) ? k + below : states - 1;
+        const std::int64_t lastColumn = (k + above < states) ? k + above : states - 1;
+        for (std::int64_t i = k + 1; i <= lastRow; ++i) {
+            double* row = &band[static_cast<std::size_t>(i * width)];
+            const double factor = row[k - i + below] / pivot;
+            if (factor == 0.0) continue;
+            for (std::int64_t j = k; j <= lastColumn; ++j) {
+                row[j - i + below] -= factor * pivotRow[j - k + below];
+            }
+            ruin[static_cast<std::size_t>(i)] -= factor * ruin[static_cast<std::size_t>(k)];
+        }
+    }
+
+    // Back substitution
+    for (std::int64_t i = states - 1; i >= 0; --i) {
+        const double* row = &band[static_cast<std::size_t>(i * width)];
+        const std::int64_t lastColumn = (i + above < states) ? i + above : states - 1;
+        double sum = ruin[static_cast<std::size_t>(i)];
+        for (std::int64_t j = i + 1; j <= lastColumn; ++j) {
+            sum -= row[j - i + below] * ruin[static_cast<std::size_t>(j)];
+        }
+        ruin[static_cast<std::size_t>(i)] = sum / row[below];
+    }
+    return ruin;
+}
+
+/**
+ * @brief The infinite-horizon ruin probability of any payout table, from the absorbing chain.
+ * @param table The outcomes of a bet, with probabilities summing to 1.
+ * @param startUnits The starting bankroll in bet units (see makeLatticeScenario).
+ */
+inline double solveInfiniteHorizon(const PayoutTable& table, std::int64_t startUnits) {
+    // The largest chain solved; past it the last answer is returned as it is
+    const std::int64_t MAX_STATES = std::int64_t(1) << 22;
+
+    double drift = 0.0;
+    bool canLose = false;
+    for (const PayoutOutcome& outcome : table) {
+        drift += outcome.probability * static_cast<double>(outcome.units);
+        if (outcome.units < 0 && outcome.probability > 0.0) canLose = true;
+    }
+
+    // A start below one bet still plays its first bet, like the simulation
+    if (startUnits < RUIN_THRESHOLD_UNITS) {
+        double ruin = 0.0;
+        for (const PayoutOutcome& outcome : table) {
+            std::int64_t next = startUnits + outcome.units;
+            ruin += outcome.probability * ((next < RUIN_THRESHOLD_UNITS) ? 1.0 : solveInfiniteHorizon(table, next));
+        }
+        return ruin;
+    }
+    if (!canLose) return 0.0;
+    if (drift <= 0.0) return 1.0;
+
+    // The cut only lowers r, less and less as it moves up, so stop once doubling it changes nothing
+    const std::int64_t start = startUnits - RUIN_THRESHOLD_UNITS;
+    std::int64_t states = start + 1 + 64 * static_cast<std::int64_t>(table.size());
+    double ruin = solveCutChain(table, states)[static_cast<std::size_t>(start)];
+    while (states < MAX_STATES) {
+        states *= 2;
+        double longer = solveCutChain(table, states)[static_cast<std::size_t>(start)];
+        bool settled = std::fabs(longer - ruin) <= 1e-15 * longer;
+        ruin = longer;
+        if (settled) break;
+    }
+    return ruin;
+}
+
+/**
+ * @brief The infinite-horizon ruin probability of a payout table: in closed form for the
+ * fixed-bet game, from the absorbing chain otherwise.
+ */
+inline double infiniteHorizonRuinProbability(const PayoutTable& table, std::int64_t startUnits) {
+    if (table.size() == 2 && table[0].units == 1 && table[1].units == -1) {
+        return evenMoneyInfiniteRuinProbability(startUnits, table[0].probability);
+    }
+    return solveInfiniteHorizon(table, startUnits);
+}
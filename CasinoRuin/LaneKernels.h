@@ -0,0 +1,318 @@
+#pragma once
+
+#include <cstdint>      // Fixed-width lane types and INT32_MAX
+
+#include "CpuFeatures.h"
+#include "Lattice.h"
+#include "Philox.h"
+#include "Bernoulli.h"
+
+// The most runs a kernel advances in lockstep (AVX-512: 16 x 32-bit lanes).
+const int MAX_LANES = 16;
+
+/**
+ * @brief Signature shared by every lane-parallel kernel.
+ * Simulates laneCount independent runs in lockstep on the integer lattice (see Lattice.h).
+ * Lane k is run firstRunIndex + k and reads bet i from word i of that run's Philox stream,
+ * so every kernel gives the same result for the same run.
+ * @param streamKey The (master seed, scenario) key of the random streams.
+ * @param startUnits The starting bankroll in bet units.
+ * @param houseWin The house's win probability as a precomputed threshold (see Bernoulli.h).
+ * @param finalUnits Receives laneCount final bankrolls in bet units
+ * (below RUIN_THRESHOLD_UNITS means the house was ruined).
+ */
+typedef void (*RunBatchKernel)(PhiloxKey streamKey, std::int64_t startUnits, long long numBets,
+    const BernoulliThreshold& houseWin, long long firstRunIndex, int laneCount, std::int64_t* finalUnits);
+
+/**
+ * @brief Settles the lanes whose bet word equals the threshold's high word (about one bet
+ * in 2^32), by reading the low word from each run's tie-break stream (see Bernoulli.h).
+ * @param words This bet's word for each lane.
+ * @param wins In/out: -1 where the house wins, 0 where it loses.
+ */
+inline void resolveTiedLanes(const BernoulliThreshold& houseWin, PhiloxKey streamKey, long long firstRunIndex,
+    long long betIndex, int laneCount, const std::uint32_t* words, std::int32_t* wins) {
+    for (int k = 0; k < laneCount; ++k) {
+        if (words[k] == houseWin.hi) {
+            std::uint32_t low = tieBreakWord(streamKey, static_cast<std::uint64_t>(firstRunIndex + k), static_cast<std::uint64_t>(betIndex));
+            wins[k] = (low < houseWin.lo) ? -1 : 0;
+        }
+    }
+}
+
+/**
+ * @brief True when every position a run can reach fits the 32-bit lanes of the vector kernels.
+ * Runs start at startUnits and stop at 0, so only the upper end can overflow.
+ */
+inline bool fitsInt32Lanes(std::int64_t startUnits, long long numBets) {
+    return startUnits >= 0 && startUnits + numBets <= INT32_MAX;
+}
+
+/**
+ * @brief Portable fallback: the same algorithm, one lane at a time, on 64-bit units.
+ * Produces bit-identical results to the vector kernels.
+ */
+inline void runBatchScalar(PhiloxKey streamKey, std::int64_t startUnits, long long numBets,
+    const BernoulliThreshold& houseWin, long long firstRunIndex, int laneCount, std::int64_t* finalUnits) {
+
+    for (int k = 0; k < laneCount; ++k) {
+        std::uint64_t runIndex = static_cast<std::uint64_t>(firstRunIndex + k);
+        PhiloxStream stream(streamKey, runIndex);
+        std::int64_t units = startUnits;
+
+        for (long long i = 0; i < numBets; ++i) {
+            units += houseWinsBet(houseWin, stream(), streamKey, runIndex, static_cast<std::uint64_t>(i)) ? 1 : -1;
+            if (units < RUIN_THRESHOLD_UNITS) {
+                break;
+            }
+        }
+        finalUnits[k] = units;
+    }
+}
+
+#if CASINO_X86_SIMD
+
+/**
+ * @brief 8 lanes of the full 32 x 32 -> 64-bit product. _mm256_mul_epu32 only multiplies the
+ * even lanes, so the odd lanes are shifted down, multiplied separately and blended back.
+ */
+CASINO_TARGET_AVX2 inline void mulhilo32Avx2(__m256i multiplier, __m256i value, __m256i& hi, __m256i& lo) {
+    __m256i evenProduct = _mm256_mul_epu32(multiplier, value);
+    __m256i oddProduct = _mm256_mul_epu32(multiplier, _mm256_srli_epi64(value, 32));
+    lo = _mm256_blend_epi32(evenProduct, _mm256_slli_epi64(oddProduct, 32), 0xAA);
+    hi = _mm256_blend_epi32(_mm256_srli_epi64(evenProduct, 32), oddProduct, 0xAA);
+}
+
+/**
+ * @brief Philox4x32-10 for 8 runs at once. c holds the counters on entry and the words on exit.
+ */
+CASINO_TARGET_AVX2 inline void philox4x32Avx2(__m256i c[4], PhiloxKey key) {
+    const __m256i m0 = _mm256_set1_epi32(static_cast<int>(PHILOX_M0));
+    const __m256i m1 = _mm256_set1_epi32(static_cast<int>(PHILOX_M1));
+    std::uint32_t k0 = key.k0, k1 = key.k1;
+
+    for (int round = 0; round < PHILOX_ROUNDS; ++round) {
+        __m256i hi0, lo0, hi1, lo1;
+        mulhilo32Avx2(m0, c[0], hi0, lo0);
+        mulhilo32Avx2(m1, c[2], hi1, lo1);
+        c[0] = _mm256_xor_si256(_mm256_xor_si256(hi1, c[1]), _mm256_set1_epi32(static_cast<int>(k0)));
+        c[1] = lo1;
+        c[2] = _mm256_xor_si256(_mm256_xor_si256(hi0, c[3]), _mm256_set1_epi32(static_cast<int>(k1)));
+        c[3] = lo0;
+        k0 += PHILOX_W0;
+        k1 += PHILOX_W1;
+    }
+}
+
+/**
+ * @brief AVX2 kernel: 8 runs per register. Random words come from an 8-lane Philox, and
+ * the bankrolls (as 32-bit bet units) live in one 8-lane register. Each bet is a branchless
+ * masked +1/-1; lanes that hit ruin drop out of the "alive" mask and keep their ruined bankroll.
+ */
+CASINO_TARGET_AVX2 inline void runBatchAvx2(PhiloxKey streamKey, std::int64_t startUnits, long long numBets,
+    const BernoulliThreshold& houseWin, long long firstRunIndex, int laneCount, std::int64_t* finalUnits) {
+
+    if (!fitsInt32Lanes(startUnits, numBets)) {
+        runBatchScalar(streamKey, startUnits, numBets, houseWin, firstRunIndex, laneCount, finalUnits);
+        return;
+    }
+
+    // AVX2 only compares signed integers, so flip the sign bit on both sides
+    const __m256i signBit = _mm256_set1_epi32(static_cast<int>(0x80000000u));
+    const __m256i threshold = _mm256_set1_epi32(static_cast<int>(houseWin.hi ^ 0x80000000u));
+    const __m256i thresholdRaw = _mm256_set1_epi32(static_cast<int>(houseWin.hi));
+    const __m256i one = _mm256_set1_epi32(1);
+    const __m256i ruinLevel = _mm256_set1_epi32(static_cast<int>(RUIN_THRESHOLD_UNITS - 1));
+
+    for (int base = 0; base < laneCount; base += 8) {
+        int lanes = (laneCount - base < 8) ? laneCount - base : 8;
+
+        // Each lane's counter carries its own run index
+        std::uint32_t runLo[8], runHi[8];
+        for (int k = 0; k < 8; ++k) {
+            std::uint64_t run = static_cast<std::uint64_t>(firstRunIndex + base + k);
+            runLo[k] = static_cast<std::uint32_t>(run);
+            runHi[k] = static_cast<std::uint32_t>(run >> 32);
+        }
+        const __m256i runCounterLo = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(runLo));
+        const __m256i runCounterHi = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(runHi));
+
+        __m256i units = _mm256_set1_epi32(static_cast<int>(startUnits));
+
+        // Lanes past laneCount start (and stay) dead
+        __m256i alive = _mm256_cmpgt_epi32(_mm256_set1_epi32(lanes), _mm256_setr_epi32(0, 1, 2, 3, 4, 5, 6, 7));
+
+        for (long long block = 0; block * 4 < numBets; ++block) {
+            __m256i words[4] = {
+                _mm256_set1_epi32(static_cast<int>(static_cast<std::uint32_t>(block))),
+                _mm256_set1_epi32(static_cast<int>(static_cast<std::uint32_t>(static_cast<std::uint64_t>(block) >> 32))),
+                runCounterLo,
+                runCounterHi
+            };
+            philox4x32Avx2(words, streamKey);
+
+            long long betsInBlock = numBets - block * 4;
+            if (betsInBlock > 4) betsInBlock = 4;
+            for (int j = 0; j < betsInBlock; ++j) {
+                // win is -1 where the house wins, so (win | 1) is -1 on a win and +1 on a loss;
+                // subtracting it steps +1/-1, and masking with alive freezes ruined lanes
+                __m256i win = _mm256_cmpgt_epi32(threshold, _mm256_xor_si256(words[j], signBit));
+
+                // A word equal to the threshold's high word needs its low word to decide (rare)
+                __m256i tied = _mm256_cmpeq_epi32(words[j], thresholdRaw);
+                if (!_mm256_testz_si256(tied, alive)) {
+                    std::uint32_t laneWords[8];
+                    std::int32_t laneWins[8];
+                    _mm256_storeu_si256(reinterpret_cast<__m256i*>(laneWords), words[j]);
+                    _mm256_storeu_si256(reinterpret_cast<__m256i*>(laneWins), win);
+                    resolveTiedLanes(houseWin, streamKey, firstRunIndex + base, block * 4 + j, lanes, laneWords, laneWins);
+                    win = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(laneWins));
+                }
+
+                units = _mm256_sub_epi32(units, _mm256_and_si256(_mm256_or_si256(win, one), alive));
+
+                // Check for ruin in every lane at once
+                alive = _mm256_and_si256(alive, _mm256_cmpgt_epi32(units, ruinLevel));
+            }
+
+            // Stop early once every lane is ruined (checked periodically to keep the loop tight)
+            if ((block & 15) == 15 && _mm256_movemask_epi8(alive) == 0) {
+                break;
+            }
+        }
+
+        std::int32_t results[8];
+        _mm256_storeu_si256(reinterpret_cast<__m256i*>(results), units);
+        for (int k = 0; k < lanes; ++k) {
+            finalUnits[base + k] = results[k];
+        }
+    }
+}
+
+/**
+ * @brief 16 lanes of the full 32 x 32 -> 64-bit product (see mulhilo32Avx2).
+ * The products and shifts use the zero-masked forms with every lane selected: the plain
+ * ones pass _mm512_undefined_epi32() through, which GCC 12 reports as used uninitialized
+ * (GCC bug 105593). The compiler drops the all-ones mask, so the code is the same.
+ */
+CASINO_TARGET_AVX512 inline void mulhilo32Avx512(__m512i multiplier, __m512i value, __m512i& hi, __m512i& lo) {
+    const __mmask8 all = 0xFF;
+    __m512i evenProduct = _mm512_maskz_mul_epu32(all, multiplier, value);
+    __m512i oddProduct = _mm512_maskz_mul_epu32(all, multiplier, _mm512_maskz_srli_epi64(all, value, 32));
+    lo = _mm512_mask_blend_epi32(0xAAAA, evenProduct, _mm512_maskz_slli_epi64(all, oddProduct, 32));
+    hi = _mm512_mask_blend_epi32(0xAAAA, _mm512_maskz_srli_epi64(all, evenProduct, 32), oddProduct);
+}
+
+/**
+ * @brief Philox4x32-10 for 16 runs at once. c holds the counters on entry and the words on exit.
+ */
+CASINO_TARGET_AVX512 inline void philox4x32Avx512(__m512i c[4], PhiloxKey key) {
+    const __m512i m0 = _mm512_set1_epi32(static_cast<int>(PHILOX_M0));
+    const __m512i m1 = _mm512_set1_epi32(static_cast<int>(PHILOX_M1));
+    std::uint32_t k0 = key.k0, k1 = key.k1;
+
+    for (int round = 0; round < PHILOX_ROUNDS; ++round) {
+        __m512i hi0, lo0, hi1, lo1;
+        mulhilo32Avx512(m0, c[0], hi0, lo0);
+        mulhilo32Avx512(m1, c[2], hi1, lo1);
+        c[0] = _mm512_xor_si512(_mm512_xor_si512(hi1, c[1]), _mm512_set1_epi32(static_cast<int>(k0)));
+        c[1] = lo1;
+        c[2] = _mm512_xor_si512(_mm512_xor_si512(hi0, c[3]), _mm512_set1_epi32(static_cast<int>(k1)));
+        c[3] = lo0;
+        k0 += PHILOX_W0;
+        k1 += PHILOX_W1;
+    }
+}
+
+/**
+ * @brief AVX-512 kernel: 16 runs per register, with the alive and win masks held in mask registers.
+ */
+CASINO_TARGET_AVX512 inline void runBatchAvx512(PhiloxKey streamKey, std::int64_t startUnits, long long numBets,
+    const BernoulliThreshold& houseWin, long long firstRunIndex, int laneCount, std::int64_t* finalUnits) {
+
+    if (!fitsInt32Lanes(startUnits, numBets)) {
+        runBatchScalar(streamKey, startUnits, numBets, houseWin, firstRunIndex, laneCount, finalUnits);
+        return;
+    }
+
+    const __m512i threshold = _mm512_set1_epi32(static_cast<int>(houseWin.hi));
+    const __m512i one = _mm512_set1_epi32(1);
+    const __m512i ruinLevel = _mm512_set1_epi32(static_cast<int>(RUIN_THRESHOLD_UNITS - 1));
+
+    // Each lane's counter carries its own run index
+    std::uint32_t runLo[16], runHi[16];
+    for (int k = 0; k < 16; ++k) {
+        std::uint64_t run = static_cast<std::uint64_t>(firstRunIndex + k);
+        runLo[k] = static_cast<std::uint32_t>(run);
+        runHi[k] = static_cast<std::uint32_t>(run >> 32);
+    }
+    const __m512i runCounterLo = _mm512_loadu_si512(runLo);
+    const __m512i runCounterHi = _mm512_loadu_si512(runHi);
+
+    __m512i units = _mm512_set1_epi32(static_cast<int>(startUnits));
+
+    // Lanes past laneCount start (and stay) dead
+    __mmask16 alive = static_cast<__mmask16>((1u << laneCount) - 1u);
+
+    for (long long block = 0; block * 4 < numBets && alive != 0; ++block) {
+        __m512i words[4] = {
+            _mm512_set1_epi32(static_cast<int>(static_cast<std::uint32_t>(block))),
+            _mm512_set1_epi32(static_cast<int>(static_cast<std::uint32_t>(static_cast<std::uint64_t>(block) >> 32))),
+            runCounterLo,
+            runCounterHi
+        };
+        philox4x32Avx512(words, streamKey);
+
+        long long betsInBlock = numBets - block * 4;
+        if (betsInBlock > 4) betsInBlock = 4;
+        for (int j = 0; j < betsInBlock; ++j) {
+            // House wins add a unit, player wins take one away; ruined lanes are masked off
+            __mmask16 win = _mm512_cmplt_epu32_mask(words[j], threshold);
+
+            // A word equal to the threshold's high word needs its low word to decide (rare)
+            __mmask16 tied = static_cast<__mmask16>(_mm512_cmpeq_epu32_mask(words[j], threshold) & alive);
+            if (tied != 0) {
+                std::uint32_t laneWords[16];
+                std::int32_t laneWins[16];
+                _mm512_storeu_si512(laneWords, words[j]);
+                _mm512_storeu_si512(laneWins, _mm512_maskz_mov_epi32(win, _mm512_set1_epi32(-1)));
+                resolveTiedLanes(houseWin, streamKey, firstRunIndex, block * 4 + j, laneCount, laneWords, laneWins);
+                win = _mm512_cmpneq_epi32_mask(_mm512_loadu_si512(laneWins), _mm512_setzero_si512());
+            }
+
+            units = _mm512_mask_add_epi32(units, static_cast<__mmask16>(alive & win), units, one);
+            units = _mm512_mask_sub_epi32(units, static_cast<__mmask16>(alive & ~win), units, one);
+
+            // Check for ruin in every lane at once
+            alive &= _mm512_cmpgt_epi32_mask(units, ruinLevel);
+        }
+    }
+
+    std::int32_t results[16];
+    _mm512_storeu_si512(results, units);
+    for (int k = 0; k < laneCount; ++k) {
+        finalUnits[k] = results[k];
+    }
+}
+
+#endif // CASINO_X86_SIMD
+
+/**
+ * @brief Picks the kernel for a SIMD level. Levels the build cannot target fall back to scalar.
+ */
+inline RunBatchKernel selectRunBatchKernel(SimdLevel level) {
+#if CASINO_X86_SIMD
+    if (level == SimdLevel::Avx512) return runBatchAvx512;
+    if (level == SimdLevel::Avx2) return runBatchAvx2;
+#else
+    (void)level;
+#endif
+    return runBatchScalar;
+}
+
+/**
+ * @brief How many runs to hand the kernel for a SIMD level at once (one full register).
+ */
+inline int laneCountFor(SimdLevel level) {
+    return (level == SimdLevel::Avx512) ? 16 : 8;
+}
@@ -0,0 +1,91 @@
+#pragma once
+
+#include <cmath>        // For floor and llround
+#include <cstdint>
+
+#include "Philox.h"     // Counter-based random streams
+#include "Bernoulli.h"  // Exact integer-threshold bet outcomes
+
+// A run is ruined as soon as its bankroll drops below one bet, i.e. below 1 unit.
+const std::int64_t RUIN_THRESHOLD_UNITS = 1;
+
+/**
+ * @brief A starting bankroll expressed on the lattice the walk actually lives on.
+ * Every bet moves the bankroll by exactly one bet, so at any time
+ * bankroll = residual + units * betAmount, with 0 <= residual < betAmount.
+ * The house is ruined when units < RUIN_THRESHOLD_UNITS (i.e. bankroll < betAmount).
+ */
+struct LatticeScenario {
+    std::int64_t startUnits; // Whole bets the starting bankroll covers
+    double residual;         // The part of the bankroll smaller than one bet
+    double betAmount;
+};
+
+/**
+ * @brief Normalizes a starting bankroll to integer bet units.
+ */
+inline LatticeScenario makeLatticeScenario(double initialHouseBankroll, double betAmount) {
+    LatticeScenario lattice;
+    lattice.startUnits = static_cast<std::int64_t>(std::floor(initialHouseBankroll / betAmount));
+    lattice.residual = initialHouseBankroll - static_cast<double>(lattice.startUnits) * betAmount;
+    lattice.betAmount = betAmount;
+    return lattice;
+}
+
+/**
+ * @brief Converts a lattice position back to dollars. Only used when reporting.
+ */
+inline double unitsToDollars(const LatticeScenario& lattice, std::int64_t units) {
+    return lattice.residual + static_cast<double>(units) * lattice.betAmount;
+}
+
+/**
+ * @brief Snaps a dollar bankroll (e.g. from the reference engine) to the nearest lattice position.
+ */
+inline std::int64_t dollarsToUnits(const LatticeScenario& lattice, double bankroll) {
+    return static_cast<std::int64_t>(std::llround((bankroll - lattice.residual) / lattice.betAmount));
+}
+
+/**
+ * @brief Carries a run on from bet fromBet to bet toBet. Bet i is always word i of the
+ * run's stream, so continuing a run that survived fromBet bets gives exactly what a
+ * run of toBet bets would have (see SavedWalks.h).
+ * @param units The bankroll in bet units after bet fromBet.
+ * @param ruinBet If not null, receives the bet (fromBet + 1 to toBet) after which the
+ * house was ruined. Left untouched if it survived.
+ * @return The bankroll in bet units after bet toBet, or at ruin.
+ */
+inline std::int64_t continueLatticeRun(PhiloxKey streamKey, std::int64_t units, long long fromBet, long long toBet,
+    const BernoulliThreshold& houseWin, long long runIndex, long long* ruinBet = nullptr) {
+    PhiloxStream generator(streamKey, static_cast<std::uint64_t>(runIndex));
+    generator.seek(static_cast<std::uint64_t>(fromBet));
+
+    for (long long i = fromBet; i < toBet; ++i) {
+        bool win = houseWinsBet(houseWin, generator(), streamKey, static_cast<std::uint64_t>(runIndex), static_cast<std::uint64_t>(i));
+        units += win ? 1 : -1;
+        if (units < RUIN_THRESHOLD_UNITS) {
+            if (ruinBet) *ruinBet = i + 1;
+            break;
+        }
+    }
+    return units;
+}
+
+/**
+ * @brief Simulates a single run on the integer lattice.
+ * The same game as simulateSingleRun, but the bankroll is a whole number of bets:
+ * each bet is a +1/-1 step and ruin is an integer compare, so there is no
+ * floating-point drift however long the run is.
+ * @param streamKey The (master seed, scenario) key of the random streams.
+ * @param startUnits The starting bankroll in bet units (see makeLatticeScenario).
+ * @param numBets The total number of bets to simulate in this run.
+ * @param houseWin The house's win probability as a precomputed threshold (see makeBernoulliThreshold).
+ * @param runIndex The index of this run, which selects its own random stream.
+ * @param ruinBet If not null, receives the bet (1 to numBets) after which the house was
+ * ruined. Left untouched if it survived.
+ * @return The final bankroll in bet units. Below RUIN_THRESHOLD_UNITS means the house was ruined.
+ */
+inline std::int64_t simulateLatticeRun(PhiloxKey streamKey, std::int64_t startUnits, long long numBets, const BernoulliThreshold& houseWin, long long runIndex,
+    long long* ruinBet = nullptr) {
+    return continueLatticeRun(streamKey, startUnits, 0, numBets, houseWin, runIndex, ruinBet);
+}
@@ -0,0 +1,418 @@
+#pragma once
+
+#include <chrono>       // For picking a seed when none is given
+#include <cstdint>
+#include <cerrno>       // For errno and ERANGE
+#include <cmath>        // For HUGE_VAL
+#include <cstdlib>      // For strtod and strtoull
+#include <cstring>      // For strncmp
+#include <iostream>
+#include <string>
+
+#include "Engine.h"     // For SimulationEngine, EvaluationMode and MAX_EDGES
+
+/**
+ * @brief Settings that can be changed from the command line without recompiling.
+ * Everything else is still configured with the constants at the top of main().
+ */
+struct CommandLineOptions {
+    // The master seed of the whole sweep. Printed at startup so any run can be replayed.
+    std::uint64_t masterSeed = 0;
+    bool masterSeedGiven = false;
+
+    // Worker threads to use. 0 means one per hardware thread.
+    unsigned threadCount = 0;
+
+    // The engine that simulates runs. Unless given, main() uses its ENGINE constant.
+    SimulationEngine engine = SimulationEngine::Lanes;
+    bool engineGiven = false;
+
+    // Simulate, or solve the scenario exactly.
+    EvaluationMode mode = EvaluationMode::MonteCarlo;
+
+    // Where to record bet-by-bet paths (see PathRecorder.h). Empty means no recording.
+    std::string recordPath;
+    // How many runs of each bankroll to record, from run 0. -1 means all of them.
+    long long recordRuns = -1;
+
+    // Where to write the columnar results file (see Results.h). Empty means none.
+    std::string resultsPath;
+    // Skip the console table, e.g. when only the results file is wanted.
+    bool quiet = false;
+
+    // Adaptive stopping (see Adaptive.h): stop a bankroll once its 95% interval's half-width
+    // is at most targetAbsolute, or at most targetRelative times the estimate. 0 means unused.
+    double targetAbsolute = 0.0;
+    double targetRelative = 0.0;
+    // Most runs to simulate per bankroll. 0 means main()'s TOTAL_RUNS.
+    long long maxRuns = 0;
+
+    // Where to keep a checkpoint of the sweep (see Checkpoint.h). Empty means none.
+    std::string checkpointPath;
+    // Seconds between checkpoints; one is also written after every bankroll.
+    double checkpointSeconds = 60.0;
+    // Continue from the checkpoint instead of starting over.
+    bool resume = false;
+    // Continue from the checkpoint with this many more runs per bankroll. 0 means none.
+    long long extendRuns = 0;
+
+    // Where to save every run's state at the end of the horizon (see SavedWalks.h). Empty means none.
+    std::string saveWalksPath;
+    // Walks saved at a shorter horizon, to carry on to BETS_PER_RUN instead of starting over.
+    std::string continueWalksPath;
+
+    // The house win probabilities of an edge sweep or surface (see EdgeSweep.h): edgeCount evenly
+    // spaced from edgeFirst to edgeLast.
+    double edgeFirst = 0.50;
+    double edgeLast = 0.56;
+    int edgeCount = 13;
+    bool edgesGiven = false;
+
+    // The bankroll search (see BankrollSearch.h): the smallest bankroll whose ruin probability
+    // is at most ruinTarget, shown by simulation at this one-sided confidence.
+    double ruinTarget = 0.001;
+    double confidence = 0.95;
+    bool searchGiven = false;
+};
+
+/**
+ * @brief Prints the recognised command-line options.
+ */
+inline void printUsage(const char* program) {
+    std::cout << "Usage: " << program << " [options]" << std::endl;
+    std::cout << "  --seed=<n>    Master seed for the random streams (default: picked from the clock)" << std::endl;
+    std::cout << "  --threads=<n> Worker threads (default: one per hardware thread)" << std::endl;
+    std::cout << "  --mode=<m>    montecarlo (default), exact, closedform, importance, sweep, passage, edges, surface, minbankroll, infinite or diffusion" << std::endl;
+    std::cout << "  --edges=<a>:<b>:<n> House win probabilities of --mode=edges or surface: n from a to b (default 0.50:0.56:13)" << std::endl;
+    std::cout << "  --ruin-target=<p> Ruin probability --mode=minbankroll finds the smallest bankroll for (default 0.001)" << std::endl;
+    std::cout << "  --confidence=<c> One-sided confidence that the bankroll found meets it (default 0.95)" << std::endl;
+    std::cout << "  --engine=<e>  reference, lattice, lanes, block or bridge" << std::endl;
+    std::cout << "  --record=<f>  Record every run's bets to a memory-mapped path file" << std::endl;
+    std::cout << "  --record-runs=<n> Record only the first n runs of each bankroll" << std::endl;
+    std::cout << "  --results=<f> Write every bankroll's results to a columnar binary file" << std::endl;
+    std::cout << "  --quiet       Do not print the results table" << std::endl;
+    std::cout << "  --target=<h>  Simulate each bankroll until its 95% interval half-width is at most h" << std::endl;
+    std::cout << "  --target-relative=<r> ... or at most r times the estimated ruin probability" << std::endl;
+    std::cout << "  --max-runs=<n> Most runs per bankroll (default: TOTAL_RUNS)" << std::endl;
+    std::cout << "  --checkpoint=<f> Save the sweep to f every minute, after each bankroll and on SIGINT/SIGTERM" << std::endl;
+    std::cout << "  --checkpoint-every=<s> Seconds between checkpoints (default: 60)" << std::endl;
+    std::cout << "  --resume      Continue from the --checkpoint file where it left off" << std::endl;
+    std::cout << "  --extend=<n>  Add n runs to every bankroll of the --checkpoint file, finished or not" << std::endl;
+    std::cout << "  --save-walks=<f> Save where every run stood at the end of the horizon" << std::endl;
+    std::cout << "  --continue-walks=<f> Carry the runs saved in f on to the (longer) horizon" << std::endl;
+    std::cout << "  --help        Show this message" << std::endl;
+}
+
+/**
+ * @brief If arg looks like "--name=value", points value at the text after '='.
+ */
+inline bool matchOption(const char* arg, const char* name, const char*& value) {
+    std::size_t length = std::strlen(name);
+    if (std::strncmp(arg, name, length) != 0 || arg[length] != '=') {
+        return false;
+    }
+    value = arg + length + 1;
+    return true;
+}
+
+/**
+ * @brief Parses an unsigned decimal (or 0x hex) number, rejecting trailing junk and
+ * numbers too large for 64 bits (which strtoull would clamp to ULLONG_MAX).
+ */
+inline bool parseUnsigned(const char* text, std::uint64_t& result) {
+    if (*text == '\0' || *text == '-') return false;
+    char* end = nullptr;
+    errno = 0;
+    result = std::strtoull(text, &end, 0);
+    return *end == '\0' && errno != ERANGE;
+}
+
+/**
+ * @brief Parses a positive, finite decimal number, rejecting trailing junk.
+ */
+inline bool parsePositive(const char* text, double& result) {
+    if (*text == '\0') return false;
+    char* end = nullptr;
+    result = std::strtod(text, &end);
+    return *end == '\0' && result > 0.0 && result < HUGE_VAL;
+}
+
+/**
+ * @brief Parses "first:last:count", a grid of probabilities strictly between 0 and 1.
+ */
+inline bool parseEdgeGrid(const char* text, double& first, double& last, int& count) {
+    char* end = nullptr;
+    first = std::strtod(text, &end);
+    if (end == text || *end != ':') return false;
+    const char* next = end + 1;
+    last = std::strtod(next, &end);
+    if (end == next || *end != ':') return false;
+    std::uint64_t points = 0;
+    if (!parseUnsigned(end + 1, points) || points == 0 || points > static_cast<std::uint64_t>(MAX_EDGES)) return false;
+    count = static_cast<int>(points);
+    return first > 0.0 && last < 1.0 && first <= last && (count > 1 || first == last);
+}
+
+/**
+ * @brief Reads the command line into options.
+ * @return false if the program should exit: after --help, or after reporting a bad argument.
+ */
+inline bool parseCommandLine(int argc, char* argv[], CommandLineOptions& options) {
+    for (int i = 1; i < argc; ++i) {
+        const char* arg = argv[i];
+        const char* value = nullptr;
+
+        if (std::strcmp(arg, "--help") == 0) {
+            printUsage(argv[0]);
+            return false;
+        }
+        else if (matchOption(arg, "--seed", value)) {
+            if (!parseUnsigned(value, options.masterSeed)) {
+                std::cerr << "Invalid seed: " << value << std::endl;
+                return false;
+            }
+            options.masterSeedGiven = true;
+        }
+        else if (matchOption(arg, "--threads", value)) {
+            std::uint64_t threads = 0;
+            if (!parseUnsigned(value, threads) || threads > 4096) {
+                std::cerr << "Invalid thread count: " << value << std::endl;
+                return false;
+            }
+            options.threadCount = static_cast<unsigned>(threads);
+        }
+        else if (matchOption(arg, "--engine", value)) {
+            if (std::strcmp(value, "reference") == 0) {
+                options.engine = SimulationEngine::Reference;
+            }
+            else if (std::strcmp(value, "lattice") == 0) {
+                options.engine = SimulationEngine::Lattice;
+            }
+            else if (std::strcmp(value, "lanes") == 0) {
+                options.engine = SimulationEngine::Lanes;
+            }
+            else if (std::strcmp(value, "block") == 0) {
+                options.engine = SimulationEngine::Block;
+            }
+            else if (std::strcmp(value, "bridge") == 0) {
+                options.engine = SimulationEngine::Bridge;
+            }
+            else {
+                std::cerr << "Invalid engine: " << value << " (expected reference, lattice, lanes, block or bridge)" << std::endl;
+                return false;
+            }
+            options.engineGiven = true;
+        }
+        else if (std::strcmp(arg, "--quiet") == 0) {
+            options.quiet = true;
+        }
+        else if (matchOption(arg, "--results", value)) {
+            if (*value == '\0') {
+                std::cerr << "Invalid results file: (empty)" << std::endl;
+                return false;
+            }
+            options.resultsPath = value;
+        }
+        else if (matchOption(arg, "--target", value)) {
+            if (!parsePositive(value, options.targetAbsolute) || options.targetAbsolute >= 1.0) {
+                std::cerr << "Invalid target half-width: " << value << " (expected a probability, e.g. 0.0005)" << std::endl;
+                return false;
+            }
+        }
+        else if (matchOption(arg, "--target-relative", value)) {
+            if (!parsePositive(value, options.targetRelative)) {
+                std::cerr << "Invalid relative target: " << value << " (expected e.g. 0.05 for 5%)" << std::endl;
+                return false;
+            }
+        }
+        else if (matchOption(arg, "--max-runs", value)) {
+            std::uint64_t runs = 0;
+            if (!parseUnsigned(value, runs) || runs == 0 || runs > (1ULL << 62)) {
+                std::cerr << "Invalid run budget: " << value << std::endl;
+                return false;
+            }
+            options.maxRuns = static_cast<long long>(runs);
+        }
+        else if (matchOption(arg, "--checkpoint", value)) {
+            if (*value == '\0') {
+                std::cerr << "Invalid checkpoint file: (empty)" << std::endl;
+                return false;
+            }
+            options.checkpointPath = value;
+        }
+        else if (matchOption(arg, "--checkpoint-every", value)) {
+            if (!parsePositive(value, options.checkpointSeconds)) {
+                std::cerr << "Invalid checkpoint interval: " << value << " (expected seconds)" << std::endl;
+                return false;
+            }
+        }
+        else if (std::strcmp(arg, "--resume") == 0) {
+            options.resume = true;
+        }
+        else if (matchOption(arg, "--extend", value)) {
+            std::uint64_t runs = 0;
+            if (!parseUnsigned(value, runs) || runs == 0 || runs > (1ULL << 62)) {
+                std::cerr << "Invalid run count to extend by: " << value << std::endl;
+                return false;
+            }
+            options.extendRuns = static_cast<long long>(runs);
+        }
+        else if (matchOption(arg, "--save-walks", value)) {
+            if (*value == '\0') {
+                std::cerr << "Invalid walk file: (empty)" << std::endl;
+                return false;
+            }
+            options.saveWalksPath = value;
+        }
+        else if (matchOption(arg, "--continue-walks", value)) {
+            if (*value == '\0') {
+                std::cerr << "Invalid walk file: (empty)" << std::endl;
+                return false;
+            }
+            options.continueWalksPath = value;
+        }
+        else if (matchOption(arg, "--record", value)) {
+            if (*value == '\0') {
+                std::cerr << "Invalid record file: (empty)" << std::endl;
+                return false;
+            }
+            options.recordPath = value;
+        }
+        else if (matchOption(arg, "--record-runs", value)) {
+            std::uint64_t runs = 0;
+            if (!parseUnsigned(value, runs) || runs > (1ULL << 62)) {
+                std::cerr << "Invalid record run count: " << value << std::endl;
+                return false;
+            }
+            options.recordRuns = static_cast<long long>(runs);
+        }
+        else if (matchOption(arg, "--edges", value)) {
+            if (!parseEdgeGrid(value, options.edgeFirst, options.edgeLast, options.edgeCount)) {
+                std::cerr << "Invalid edge grid: " << value << " (expected first:last:count, e.g. 0.50:0.56:13, with at most "
+                    << MAX_EDGES << " points)" << std::endl;
+                return false;
+            }
+            options.edgesGiven = true;
+        }
+        else if (matchOption(arg, "--ruin-target", value)) {
+            if (!parsePositive(value, options.ruinTarget) || options.ruinTarget >= 1.0) {
+                std::cerr << "Invalid ruin target: " << value << " (expected a probability, e.g. 0.001)" << std::endl;
+                return false;
+            }
+            options.searchGiven = true;
+        }
+        else if (matchOption(arg, "--confidence", value)) {
+            if (!parsePositive(value, options.confidence) || options.confidence < 0.5 || options.confidence >= 1.0) {
+                std::cerr << "Invalid confidence: " << value << " (expected at least 0.5 and below 1, e.g. 0.95)" << std::endl;
+                return false;
+            }
+            options.searchGiven = true;
+        }
+        else if (matchOption(arg, "--mode", value)) {
+            if (std::strcmp(value, "montecarlo") == 0) {
+                options.mode = EvaluationMode::MonteCarlo;
+            }
+            else if (std::strcmp(value, "exact") == 0) {
+                options.mode = EvaluationMode::Exact;
+            }
+            else if (std::strcmp(value, "closedform") == 0) {
+                options.mode = EvaluationMode::ClosedForm;
+            }
+            else if (std::strcmp(value, "importance") == 0) {
+                options.mode = EvaluationMode::Importance;
+            }
+            else if (std::strcmp(value, "sweep") == 0) {
+                options.mode = EvaluationMode::Sweep;
+            }
+            else if (std::strcmp(value, "passage") == 0) {
+                options.mode = EvaluationMode::Passage;
+            }
+            else if (std::strcmp(value, "edges") == 0) {
+                options.mode = EvaluationMode::Edges;
+            }
+            else if (std::strcmp(value, "surface") == 0) {
+                options.mode = EvaluationMode::Surface;
+            }
+            else if (std::strcmp(value, "minbankroll") == 0) {
+                options.mode = EvaluationMode::MinBankroll;
+            }
+            else if (std::strcmp(value, "infinite") == 0) {
+                options.mode = EvaluationMode::Infinite;
+            }
+            else if (std::strcmp(value, "diffusion") == 0) {
+                options.mode = EvaluationMode::Diffusion;
+            }
+            else {
+                std::cerr << "Invalid mode: " << value << " (expected montecarlo, exact, closedform, importance, sweep, passage, edges, surface, minbankroll, infinite or diffusion)" << std::endl;
+                return false;
+            }
+        }
+        else {
+            std::cerr << "Unknown option: " << arg << " (see --help)" << std::endl;
+            return false;
+        }
+    }
+
+    const bool edgeModes = options.mode == EvaluationMode::Edges || options.mode == EvaluationMode::Surface;
+    if (options.edgesGiven && !edgeModes) {
+        std::cerr << "--edges needs --mode=edges or --mode=surface" << std::endl;
+        return false;
+    }
+    if (options.searchGiven && options.mode != EvaluationMode::MinBankroll) {
+        std::cerr << "--ruin-target and --confidence need --mode=minbankroll" << std::endl;
+        return false;
+    }
+
+    // The modes that answer every bankroll from one shared set of walks
+    const bool pooledModes = options.mode == EvaluationMode::Sweep || edgeModes || options.mode == EvaluationMode::MinBankroll;
+    if ((options.targetAbsolute > 0.0 || options.targetRelative > 0.0)
+        && (isComputedMode(options.mode) || pooledModes)) {
+        std::cerr << "--target needs a mode that simulates each bankroll separately (montecarlo, importance or passage)" << std::endl;
+        return false;
+    }
+
+    if (!options.recordPath.empty() && (isComputedMode(options.mode) || pooledModes)) {
+        std::cerr << "--record needs a mode that steps every run (montecarlo, importance or passage)" << std::endl;
+        return false;
+    }
+
+    if ((options.resume || options.extendRuns > 0) && options.checkpointPath.empty()) {
+        std::cerr << (options.resume ? "--resume" : "--extend") << " needs the --checkpoint file to continue from" << std::endl;
+        return false;
+    }
+
+    if (!options.checkpointPath.empty() && (isComputedMode(options.mode) || pooledModes)) {
+        std::cerr << "--checkpoint needs a mode that simulates each bankroll separately (montecarlo, importance or passage)" << std::endl;
+        return false;
+    }
+
+    // A path file is created afresh at startup, so a resumed sweep could not keep the paths already recorded
+    if (!options.checkpointPath.empty() && !options.recordPath.empty()) {
+        std::cerr << "--checkpoint cannot be combined with --record" << std::endl;
+        return false;
+    }
+
+    const bool walks = !options.saveWalksPath.empty() || !options.continueWalksPath.empty();
+    if (walks && options.mode != EvaluationMode::MonteCarlo && options.mode != EvaluationMode::Passage) {
+        std::cerr << "--save-walks and --continue-walks need a mode that steps every run at the true odds (montecarlo or passage)" << std::endl;
+        return false;
+    }
+    if (walks && (options.targetAbsolute > 0.0 || options.targetRelative > 0.0 || !options.checkpointPath.empty())) {
+        std::cerr << "--save-walks and --continue-walks need a fixed number of runs, without --target or --checkpoint" << std::endl;
+        return false;
+    }
+    // The runs continued are the runs saved, and only their remaining bets are stepped
+    if (!options.continueWalksPath.empty() && (options.maxRuns > 0 || !options.recordPath.empty())) {
+        std::cerr << "--continue-walks takes its runs from the walk file, so cannot be combined with --max-runs or --record" << std::endl;
+        return false;
+    }
+    if (walks && options.saveWalksPath == options.continueWalksPath) {
+        std::cerr << "--save-walks needs a different file from --continue-walks" << std::endl;
+        return false;
+    }
+
+    if (!options.masterSeedGiven) {
+        options.masterSeed = static_cast<std::uint64_t>(std::chrono::system_clock::now().time_since_epoch().count());
+    }
+    return true;
+}
@@ -0,0 +1,249 @@
+#pragma once
+
+#include <cstdint>
+#include <cstring>      // For memcpy
+#include <string>
+
+#if defined(_WIN32)
+#ifndef NOMINMAX
+#define NOMINMAX
+#endif
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <unistd.h>
+#endif
+
+/*
+ * Bet-by-bet path recording into a memory-mapped file.
+ *
+ * Every recorded run gets a fixed slot of ceil(n / 64) 64-bit words, one bit per bet
+ * (bit t of word w = 1 when the house won bet 64w + t), in exactly the form the block
+ * kernel already decides bets in. Recording is one store per 64 bets straight into the
+ * mapping: nothing is allocated, formatted or buffered, and the OS writes the pages back.
+ * Because slots have a fixed size, every run's place in the file is known before it is
+ * simulated, so threads record in parallel and the file is the same for any thread count.
+ *
+ * File layout (native byte order, which is little-endian on every target we build for):
+ *   PathFileHeader
+ *   PathScenarioEntry[scenarioCount]
+ *   PathIndexEntry[scenarioCount * runsPerScenario]   (scenario-major)
+ *   uint64 words[scenarioCount * runsPerScenario * wordsPerRun]
+ * A reader maps the file and finds run r of scenario s through index[s * runs + r],
+ * without parsing anything. Bits past betsPlayed are zero.
+ */
+
+const char PATH_FILE_MAGIC[8] = { 'C', 'R', 'P', 'A', 'T', 'H', 'S', '\0' };
+const std::uint32_t PATH_FILE_VERSION = 1;
+
+struct PathFileHeader {
+    char magic[8];
+    std::uint32_t version;
+    std::uint32_t scenarioCount;
+    std::uint64_t runsPerScenario;
+    std::uint64_t numBets;
+    std::uint64_t wordsPerRun;
+    std::uint64_t masterSeed;
+    std::uint64_t scenarioTableOffset; // Byte offsets from the start of the file
+    std::uint64_t indexOffset;
+    std::uint64_t pathsOffset;
+};
+
+struct PathScenarioEntry {
+    double startBankroll;
+    double betAmount;
+    double houseWinProb;        // The probability the runs were simulated with
+    std::int64_t startUnits;
+};
+
+struct PathIndexEntry {
+    std::uint64_t pathOffset;   // Byte offset of the run's first word from the start of the file
+    std::uint64_t betsPlayed;   // numBets, or the bet at which the house was ruined
+    std::int64_t finalUnits;    // Below RUIN_THRESHOLD_UNITS means the house was ruined
+};
+
+/**
+ * @brief A file of a fixed size, created (or truncated) and mapped read-write, or an
+ * existing file mapped read-only.
+ */
+class MappedFile {
+public:
+    MappedFile() : bytes(0), base(nullptr) {}
+    ~MappedFile() { close(); }
+
+    MappedFile(const MappedFile&) = delete;
+    MappedFile& operator=(const MappedFile&) = delete;
+
+    /**
+     * @return false if the file could not be created, sized or mapped.
+     */
+    bool create(const std::string& path, std::uint64_t size) {
+        close();
+        if (size == 0) return false;
+#if defined(_WIN32)
+        HANDLE file = CreateFileA(path.c_str(), GENERIC_READ | GENERIC_WRITE, 0, nullptr, CREATE_ALWAYS, FILE_ATTRIBUTE_NORMAL, nullptr);
+        if (file == INVALID_HANDLE_VALUE) return false;
+        HANDLE mapping = CreateFileMappingA(file, nullptr, PAGE_READWRITE,
+            static_cast<DWORD>(size >> 32), static_cast<DWORD>(size & 0xFFFFFFFFu), nullptr);
+        CloseHandle(file);
+        if (mapping == nullptr) return false;
+        void* view = MapViewOfFile(mapping, FILE_MAP_WRITE, 0, 0, 0);
+        CloseHandle(mapping);
+        if (view == nullptr) return false;
+#else
+        int file = ::open(path.c_str(), O_RDWR | O_CREAT | O_TRUNC, 0644);
+        if (file < 0) return false;
+        if (::ftruncate(file, static_cast<off_t>(size)) != 0) {
+            ::close(file);
+            return false;
+        }
+        void* view = ::mmap(nullptr, static_cast<std::size_t>(size), PROT_READ | PROT_WRITE, MAP_SHARED, file, 0);
+        ::close(file);
+        if (view == MAP_FAILED) return false;
+#endif
+        base = static_cast<unsigned char*>(view);
+        bytes = size;
+        return true;
+    }
+
+    /**
+     * @brief Maps an existing file read-only; write through data() only after create.
+     * @return false if the file could not be opened or mapped, or is empty.
+     */
+    bool openReadOnly(const std::string& path) {
+        close();
+#if defined(_WIN32)
+        HANDLE file = CreateFileA(path.c_str(), GENERIC_READ, FILE_SHARE_READ, nullptr, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, nullptr);
+        if (file == INVALID_HANDLE_VALUE) return false;
+        LARGE_INTEGER fileSize;
+        if (!GetFileSizeEx(file, &fileSize) || fileSize.QuadPart == 0) {
+            CloseHandle(file);
+            return false;
+        }
+        HANDLE mapping = CreateFileMappingA(file, nullptr, PAGE_READONLY, 0, 0, nullptr);
+        CloseHandle(file);
+        if (mapping == nullptr) return false;
+        void* view = MapViewOfFile(mapping, FILE_MAP_READ, 0, 0, 0);
+        CloseHandle(mapping);
+        if (view == nullptr) return false;
+        std::uint64_t size = static_cast<std::uint64_t>(fileSize.QuadPart);
+#else
+        int file = ::open(path.c_str(), O_RDONLY);
+        if (file < 0) return false;
+        off_t end = ::lseek(file, 0, SEEK_END);
+        if (end <= 0) {
+            ::close(file);
+            return false;
+        }
+        std::uint64_t size = static_cast<std::uint64_t>(end);
+        void* view = ::mmap(nullptr, static_cast<std::size_t>(size), PROT_READ, MAP_SHARED, file, 0);
+        ::close(file);
+        if (view == MAP_FAILED) return false;
+#endif
+        base = static_cast<unsigned char*>(view);
+        bytes = size;
+        return true;
+    }
+
+    /**
+     * @brief Unmaps the file; the OS writes any dirty pages back.
+     */
+    void close() {
+        if (base == nullptr) return;
+#if defined(_WIN32)
+        UnmapViewOfFile(base);
+#else
+        ::munmap(base, static_cast<std::size_t>(bytes));
+#endif
+        base = nullptr;
+        bytes = 0;
+    }
+
+    unsigned char* data() const { return base; }
+    std::uint64_t size() const { return bytes; }
+
+private:
+    std::uint64_t bytes;
+    unsigned char* base;
+};
+
+/**
+ * @brief Lays out a path file and hands out each run's slot in it.
+ * Different runs touch disjoint bytes, so any number of threads may record at once.
+ */
+class PathRecorder {
+public:
+    PathRecorder() : header() {}
+
+    /**
+     * @brief Creates the file, sized for every run it will hold, and writes its header.
+     * @param runsPerScenario How many runs of each scenario are recorded (runs 0 and up).
+     * @return false if the file could not be created.
+     */
+    bool open(const std::string& path, std::uint32_t scenarioCount, std::uint64_t runsPerScenario,
+        std::uint64_t numBets, std::uint64_t masterSeed) {
+        std::memcpy(header.magic, PATH_FILE_MAGIC, sizeof(header.magic));
+        header.version = PATH_FILE_VERSION;
+        header.scenarioCount = scenarioCount;
+        header.runsPerScenario = runsPerScenario;
+        header.numBets = numBets;
+        header.wordsPerRun = (numBets + 63) / 64;
+        header.masterSeed = masterSeed;
+
+        const std::uint64_t totalRuns = static_cast<std::uint64_t>(scenarioCount) * runsPerScenario;
+        header.scenarioTableOffset = sizeof(PathFileHeader);
+        header.indexOffset = header.scenarioTableOffset + scenarioCount * sizeof(PathScenarioEntry);
+        header.pathsOffset = header.indexOffset + totalRuns * sizeof(PathIndexEntry);
+        const std::uint64_t size = header.pathsOffset + totalRuns * header.wordsPerRun * sizeof(std::uint64_t);
+
+        if (!file.create(path, size)) return false;
+        std::memcpy(file.data(), &header, sizeof(header));
+        return true;
+    }
+
+    bool isOpen() const { return file.data() != nullptr; }
+    std::uint64_t runsPerScenario() const { return header.runsPerScenario; }
+
+    /**
+     * @brief Records the settings a scenario's runs were simulated with.
+     */
+    void describeScenario(std::uint32_t scenarioId, double startBankroll, double betAmount, double houseWinProb, std::int64_t startUnits) {
+        PathScenarioEntry entry;
+        entry.startBankroll = startBankroll;
+        entry.betAmount = betAmount;
+        entry.houseWinProb = houseWinProb;
+        entry.startUnits = startUnits;
+        std::memcpy(file.data() + header.scenarioTableOffset + scenarioId * sizeof(PathScenarioEntry), &entry, sizeof(entry));
+    }
+
+    /**
+     * @brief The words a run's bets are written to (see simulateBlockRun), or null if the
+     * run is not recorded.
+     */
+    std::uint64_t* pathWords(std::uint32_t scenarioId, long long runIndex) const {
+        if (static_cast<std::uint64_t>(runIndex) >= header.runsPerScenario) return nullptr;
+        return reinterpret_cast<std::uint64_t*>(file.data() + pathOffset(scenarioId, runIndex));
+    }
+
+    /**
+     * @brief Writes a recorded run's index entry once the run is over.
+     */
+    void finishRun(std::uint32_t scenarioId, long long runIndex, long long betsPlayed, std::int64_t finalUnits) {
+        PathIndexEntry entry;
+        entry.pathOffset = pathOffset(scenarioId, runIndex);
+        entry.betsPlayed = static_cast<std::uint64_t>(betsPlayed);
+        entry.finalUnits = finalUnits;
+        std::uint64_t slot = static_cast<std::uint64_t>(scenarioId) * header.runsPerScenario + static_cast<std::uint64_t>(runIndex);
+        std::memcpy(file.data() + header.indexOffset + slot * sizeof(PathIndexEntry), &entry, sizeof(entry));
+    }
+
+private:
+    std::uint64_t pathOffset(std::uint32_t scenarioId, long long runIndex) const {
+        std::uint64_t slot = static_cast<std::uint64_t>(scenarioId) * header.runsPerScenario + static_cast<std::uint64_t>(runIndex);
+        return header.pathsOffset + slot * header.wordsPerRun * sizeof(std::uint64_t);
+    }
+
+    PathFileHeader header;
+    MappedFile file;
+};
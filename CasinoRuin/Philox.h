@@ -0,0 +1,158 @@
+#pragma once
+
+#include <cstdint>
+#include <limits>
+
+/*
+ * Counter-based random numbers (Philox4x32-10, Salmon et al., "Parallel Random
+ * Numbers: As Easy as 1, 2, 3", SC 2011).
+ *
+ * Instead of a generator with hidden state, each block of four 32-bit words is a
+ * pure function of (key, counter). We key the function with (master seed, scenario)
+ * and put (run index, block index) in the counter, so:
+ *   - every run has its own stream, and reaching any point of it is O(1);
+ *   - a run's numbers never depend on which thread ran it or in what order,
+ *     so results are bit-identical for 1 thread or 128;
+ *   - a whole sweep is replayed exactly from its master seed.
+ */
+
+// Round multipliers and key increments from the Philox paper
+const std::uint32_t PHILOX_M0 = 0xD2511F53u;
+const std::uint32_t PHILOX_M1 = 0xCD9E8D57u;
+const std::uint32_t PHILOX_W0 = 0x9E3779B9u;
+const std::uint32_t PHILOX_W1 = 0xBB67AE85u;
+const int PHILOX_ROUNDS = 10;
+
+// The top bits of the run counter word select independent sub-streams of the same run,
+// so extra randomness a run occasionally needs never shifts its main bet stream.
+const int STREAM_DOMAIN_SHIFT = 28;             // Leaves 60 bits for the run index
+const std::uint32_t STREAM_BETS = 0;            // One word per bet
+const std::uint32_t STREAM_TIE_BREAK = 1;       // Extra bits for exact Bernoulli draws (Bernoulli.h)
+const std::uint32_t STREAM_BRIDGE = 2;          // Whole-run draws of the bridge sampler (Bridge.h)
+
+/**
+ * @brief The 64-bit key that selects one scenario's family of run streams.
+ */
+struct PhiloxKey {
+    std::uint32_t k0;
+    std::uint32_t k1;
+};
+
+/**
+ * @brief One step of the SplitMix64 sequence, used to turn seeds into well-mixed keys.
+ */
+inline std::uint64_t splitMix64(std::uint64_t& state) {
+    std::uint64_t z = (state += 0x9E3779B97F4A7C15ULL);
+    z = (z ^ (z >> 30)) * 0xBF58476D1CE4E5B9ULL;
+    z = (z ^ (z >> 27)) * 0x94D049BB133111EBULL;
+    return z ^ (z >> 31);
+}
+
+/**
+ * @brief Derives the stream key for one scenario of a sweep.
+ * @param masterSeed The user-visible seed of the whole sweep.
+ * @param scenarioId Which scenario (e.g. the index into bankrollsToTest).
+ */
+inline PhiloxKey makeStreamKey(std::uint64_t masterSeed, std::uint64_t scenarioId) {
+    std::uint64_t state = masterSeed;
+    std::uint64_t mixedSeed = splitMix64(state);
+    state = mixedSeed ^ scenarioId;
+    std::uint64_t key = splitMix64(state);
+
+    PhiloxKey result;
+    result.k0 = static_cast<std::uint32_t>(key);
+    result.k1 = static_cast<std::uint32_t>(key >> 32);
+    return result;
+}
+
+/**
+ * @brief The full 32 x 32 -> 64-bit product, split into its high and low words.
+ */
+inline void mulhilo32(std::uint32_t a, std::uint32_t b, std::uint32_t& hi, std::uint32_t& lo) {
+    std::uint64_t product = static_cast<std::uint64_t>(a) * b;
+    hi = static_cast<std::uint32_t>(product >> 32);
+    lo = static_cast<std::uint32_t>(product);
+}
+
+/**
+ * @brief Philox4x32-10: maps (key, 128-bit counter) to four independent random 32-bit words.
+ * @param counter Counter words; by convention {block lo, block hi, run lo, run hi}.
+ * @param out Receives the four random words.
+ */
+inline void philox4x32(const std::uint32_t counter[4], PhiloxKey key, std::uint32_t out[4]) {
+    std::uint32_t c0 = counter[0], c1 = counter[1], c2 = counter[2], c3 = counter[3];
+    std::uint32_t k0 = key.k0, k1 = key.k1;
+
+    for (int round = 0; round < PHILOX_ROUNDS; ++round) {
+        std::uint32_t hi0, lo0, hi1, lo1;
+        mulhilo32(PHILOX_M0, c0, hi0, lo0);
+        mulhilo32(PHILOX_M1, c2, hi1, lo1);
+        c0 = hi1 ^ c1 ^ k0;
+        c1 = lo1;
+        c2 = hi0 ^ c3 ^ k1;
+        c3 = lo0;
+        k0 += PHILOX_W0;
+        k1 += PHILOX_W1;
+    }
+
+    out[0] = c0; out[1] = c1; out[2] = c2; out[3] = c3;
+}
+
+/**
+ * @brief The random stream of a single run: a sequence of 32-bit words read four at a time.
+ * Satisfies the standard UniformRandomBitGenerator requirements, so it can drive
+ * std:: distributions as a drop-in replacement for std::mt19937.
+ */
+class PhiloxStream {
+public:
+    typedef std::uint32_t result_type;
+
+    /**
+     * @param key The scenario's stream key (see makeStreamKey).
+     * @param runIndex The run this stream belongs to.
+     * @param domain Which of the run's sub-streams to read (STREAM_BETS, ...).
+     */
+    PhiloxStream(PhiloxKey key, std::uint64_t runIndex, std::uint32_t domain = STREAM_BETS)
+        : key(key), blockIndex(0), nextWord(4) {
+        counter[0] = 0;
+        counter[1] = 0;
+        counter[2] = static_cast<std::uint32_t>(runIndex);
+        counter[3] = static_cast<std::uint32_t>(runIndex >> 32) | (domain << STREAM_DOMAIN_SHIFT);
+    }
+
+    static constexpr result_type min() { return 0; }
+    static constexpr result_type max() { return std::numeric_limits<result_type>::max(); }
+
+    /**
+     * @brief The next 32-bit word of the stream.
+     */
+    result_type operator()() {
+        if (nextWord == 4) {
+            counter[0] = static_cast<std::uint32_t>(blockIndex);
+            counter[1] = static_cast<std::uint32_t>(blockIndex >> 32);
+            philox4x32(counter, key, buffer);
+            ++blockIndex;
+            nextWord = 0;
+        }
+        return buffer[nextWord++];
+    }
+
+    /**
+     * @brief Jumps straight to word number wordIndex of the stream, in O(1).
+     */
+    void seek(std::uint64_t wordIndex) {
+        blockIndex = wordIndex / 4;
+        nextWord = 4;
+        if (wordIndex % 4 != 0) {
+            (*this)();
+            nextWord = static_cast<int>(wordIndex % 4);
+        }
+    }
+
+private:
+    PhiloxKey key;
+    std::uint32_t counter[4];
+    std::uint64_t blockIndex;
+    std::uint32_t buffer[4];
+    int nextWord;
+};
@@ -0,0 +1,333 @@
+#pragma once
+
+#include <chrono>       // For timing each bankroll
+#include <cmath>        // For sqrt
+#include <cstdint>
+#include <cstring>      // For memcpy and strncpy
+#include <fstream>
+#include <iomanip>      // For setw and setprecision
+#include <iostream>
+#include <string>
+#include <vector>
+
+#include "Engine.h"     // For EvaluationMode
+#include "Histogram.h"  // For HistogramBins
+
+/*
+ * The results of a whole sweep, kept in memory as one ScenarioResult per bankroll.
+ * The console table is one renderer over them (printScenarioRow); writeResultsFile is
+ * another, for tools that want the numbers without scraping text.
+ */
+
+/**
+ * @brief A two-sided confidence interval for a probability.
+ */
+struct ConfidenceInterval {
+    double low = 0.0;
+    double high = 0.0;
+};
+
+// The two-sided 95% normal quantile
+const double Z_95 = 1.959963984540054;
+
+/**
+ * @brief The Wilson score interval for a binomial proportion. Unlike the normal
+ * approximation it stays inside [0, 1] and is sensible even with no successes at all.
+ */
+inline ConfidenceInterval wilsonInterval(long long successes, long long trials, double z = Z_95) {
+    ConfidenceInterval interval;
+    if (trials <= 0) {
+        interval.high = 1.0;
+        return interval;
+    }
+    double n = static_cast<double>(trials);
+    double fraction = static_cast<double>(successes) / n;
+    double z2 = z * z;
+    double centre = (fraction + z2 / (2.0 * n)) / (1.0 + z2 / n);
+    double halfWidth = z * std::sqrt(fraction * (1.0 - fraction) / n + z2 / (4.0 * n * n)) / (1.0 + z2 / n);
+    interval.low = (centre - halfWidth > 0.0) ? centre - halfWidth : 0.0;
+    interval.high = (centre + halfWidth < 1.0) ? centre + halfWidth : 1.0;
+    return interval;
+}
+
+/**
+ * @brief An interval for a proportion, rescaled to a probability that is a fixed multiple
+ * of it (see importanceSamplingEstimate), and kept at most 1.
+ */
+inline ConfidenceInterval scaledInterval(ConfidenceInterval interval, double scale) {
+    interval.low *= scale;
+    interval.high *= scale;
+    if (interval.high > 1.0) interval.high = 1.0;
+    return interval;
+}
+
+/**
+ * @brief Wall time since start, in seconds.
+ */
+inline double secondsSince(std::chrono::steady_clock::time_point start) {
+    return std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+}
+
+/**
+ * @brief Everything reported about one bankroll.
+ */
+struct ScenarioResult {
+    EvaluationMode mode = EvaluationMode::MonteCarlo;
+    double startBankroll = 0.0;
+    double betAmount = 0.0;
+    double houseWinProb = 0.0;
+    long long betsPerRun = 0;         // 0 for the infinite horizon
+    long long totalRuns = 0;          // Runs simulated; 0 for the exact modes
+    long long ruinCount = -1;         // -1 for the exact modes
+    double ruinProbability = 0.0;
+    ConfidenceInterval interval;      // 95% (a bankroll search: at its confidence); a single point for the exact modes
+    double relativeError = 0.0;       // Importance sampling, and the diffusion's estimated error
+    double elapsedSeconds = 0.0;      // Wall time spent on this bankroll
+    bool adaptive = false;            // Simulated until a precision target (see Adaptive.h)
+    bool targetMet = false;           // ... and met it within the run budget
+    HistogramBins histogram;          // Surviving bankrolls; empty if not charted
+};
+
+/**
+ * @brief Prints a bankroll's row of the console table.
+ */
+inline void printScenarioRow(const ScenarioResult& result) {
+    std::cout << "$" << std::setw(17) << result.startBankroll << " | ";
+    if (isExactMode(result.mode)) {
+        std::cout << std::setw(12) << "exact" << " | "
+            << std::setw(12) << std::scientific << std::setprecision(6) << (result.ruinProbability * 100.0)
+            << std::fixed << std::setprecision(5) << std::endl;
+    }
+    else if (result.mode == EvaluationMode::Diffusion) {
+        std::cout << std::setw(12) << "diffusion" << " | "
+            << std::setw(12) << std::scientific << std::setprecision(6) << (result.ruinProbability * 100.0)
+            << std::setprecision(1) << " (estimated error " << (result.relativeError * 100.0) << "%)"
+            << std::fixed << std::setprecision(5) << std::endl;
+    }
+    else if (result.mode == EvaluationMode::Edges) {
+        // One row per win probability of the grid, each with its own interval
+        std::cout << std::setw(12) << result.ruinCount << " | "
+            << std::setw(12) << (result.ruinProbability * 100.0)
+            << " at p = " << (result.houseWinProb * 100.0) << "%, 95% [" << (result.interval.low * 100.0)
+            << "%, " << (result.interval.high * 100.0) << "%]" << std::endl;
+    }
+    else if (result.mode == EvaluationMode::Importance) {
+        std::cout << std::setw(12) << result.ruinCount << " | "
+            << std::setw(12) << std::scientific << std::setprecision(6) << (result.ruinProbability * 100.0)
+            << std::fixed << std::setprecision(2) << " (relative error " << (result.relativeError * 100.0) << "%)"
+            << std::setprecision(5) << std::endl;
+    }
+    else {
+        std::cout << std::setw(12) << result.ruinCount << " | "
+            << std::setw(12) << (result.ruinProbability * 100.0)
+            << std::endl;
+    }
+    if (result.adaptive) {
+        std::cout << "    Stopped after " << result.totalRuns << " runs ("
+            << (result.targetMet ? "target met" : "run budget spent before the target was met")
+            << "), 95% interval [" << std::scientific << std::setprecision(4) << (result.interval.low * 100.0)
+            << "%, " << (result.interval.high * 100.0) << "%]" << std::fixed << std::setprecision(5) << std::endl;
+    }
+}
+
+/**
+ * @brief Prints a surface (see EdgeSweep.h) as three matrices, a row per bankroll and a
+ * column per win probability: the ruin probability, then the low and high ends of its 95%
+ * interval, all in percent.
+ * @param cells The surface's results, bankroll-major.
+ * @param edges The number of win probabilities per bankroll.
+ */
+inline void printSurfaceTable(const std::vector<ScenarioResult>& cells, std::size_t edges) {
+    if (edges == 0) return;
+    const char* titles[3] = { "Ruin probability (%)", "95% interval, low end (%)", "95% interval, high end (%)" };
+    for (int table = 0; table < 3; ++table) {
+        std::cout << titles[table] << std::endl;
+        std::cout << std::setw(18) << "Bankroll \\ p (%)" << std::setprecision(3);
+        for (std::size_t e = 0; e < edges; ++e) {
+            std::cout << " | " << std::setw(9) << (cells[e].houseWinProb * 100.0);
+        }
+        std::cout << std::setprecision(5) << std::endl;
+        for (std::size_t row = 0; row + edges <= cells.size(); row += edges) {
+            std::cout << "$" << std::setw(17) << cells[row].startBankroll;
+            for (std::size_t e = 0; e < edges; ++e) {
+                const ScenarioResult& cell = cells[row + e];
+                double value = (table == 0) ? cell.ruinProbability : (table == 1) ? cell.interval.low : cell.interval.high;
+                std::cout << " | " << std::setw(9) << (value * 100.0);
+            }
+            std::cout << std::endl;
+        }
+        std::cout << std::endl;
+    }
+}
+
+/*
+ * The columnar results file: a self-describing header, then one contiguous array per
+ * column, every value 8 bytes and little-endian whatever the host. A reader maps the file,
+ * looks a column up by name and reads rowCount * valuesPerRow values from its offset.
+ *
+ *   char     magic[8]          "CRRESULT"
+ *   uint32   version
+ *   uint32   columnCount
+ *   uint64   rowCount           (one row per bankroll, in sweep order; an edge sweep or surface
+ *                                has one per bankroll and win probability, bankroll-major,
+ *                                so each column is a dense matrix; see EdgeSweep.h)
+ *   columnCount descriptors of 48 bytes:
+ *     char   name[32]          zero-padded
+ *     uint32 type              RESULT_COLUMN_INT64 or RESULT_COLUMN_FLOAT64
+ *     uint32 valuesPerRow      1, or the number of histogram bins
+ *     uint64 offset            bytes from the start of the file
+ *   column data
+ *
+ * The columns are listed in writeResultsFile; "mode" holds the EvaluationMode's value and
+ * "target_met" is 1 or 0 for adaptive runs (see Adaptive.h) and -1 otherwise.
+ */
+
+const char RESULTS_FILE_MAGIC[8] = { 'C', 'R', 'R', 'E', 'S', 'U', 'L', 'T' };
+const std::uint32_t RESULTS_FILE_VERSION = 1;
+const std::uint32_t RESULT_COLUMN_INT64 = 0;
+const std::uint32_t RESULT_COLUMN_FLOAT64 = 1;
+
+/**
+ * @brief Builds a results file in memory, column by column.
+ */
+class ColumnarWriter {
+public:
+    explicit ColumnarWriter(std::uint64_t rowCount) : rowCount(rowCount) {}
+
+    void addInt64(const char* name, const std::vector<std::int64_t>& values, std::uint32_t valuesPerRow = 1) {
+        Column column;
+        column.name = name;
+        column.type = RESULT_COLUMN_INT64;
+        column.valuesPerRow = valuesPerRow;
+        for (std::int64_t value : values) {
+            column.words.push_back(static_cast<std::uint64_t>(value));
+        }
+        columns.push_back(column);
+    }
+
+    void addFloat64(const char* name, const std::vector<double>& values, std::uint32_t valuesPerRow = 1) {
+        Column column;
+        column.name = name;
+        column.type = RESULT_COLUMN_FLOAT64;
+        column.valuesPerRow = valuesPerRow;
+        for (double value : values) {
+            std::uint64_t bits;
+            std::memcpy(&bits, &value, sizeof(bits));
+            column.words.push_back(bits);
+        }
+        columns.push_back(column);
+    }
+
+    /**
+     * @return false if the file could not be written.
+     */
+    bool write(const std::string& path) const {
+        const std::uint64_t HEADER_BYTES = 24;
+        const std::uint64_t DESCRIPTOR_BYTES = 48;
+
+        std::vector<unsigned char> bytes;
+        bytes.insert(bytes.end(), RESULTS_FILE_MAGIC, RESULTS_FILE_MAGIC + 8);
+        appendLittleEndian(bytes, RESULTS_FILE_VERSION, 4);
+        appendLittleEndian(bytes, static_cast<std::uint32_t>(columns.size()), 4);
+        appendLittleEndian(bytes, rowCount, 8);
+
+        std::uint64_t offset = HEADER_BYTES + DESCRIPTOR_BYTES * columns.size();
+        for (const Column& column : columns) {
+            char name[32] = {};
+            std::strncpy(name, column.name.c_str(), sizeof(name) - 1);
+            bytes.insert(bytes.end(), name, name + sizeof(name));
+            appendLittleEndian(bytes, column.type, 4);
+            appendLittleEndian(bytes, column.valuesPerRow, 4);
+            appendLittleEndian(bytes, offset, 8);
+            offset += 8 * column.words.size();
+        }
+        for (const Column& column : columns) {
+            for (std::uint64_t word : column.words) {
+                appendLittleEndian(bytes, word, 8);
+            }
+        }
+
+        std::ofstream file(path.c_str(), std::ios::binary | std::ios::trunc);
+        file.write(reinterpret_cast<const char*>(bytes.data()), static_cast<std::streamsize>(bytes.size()));
+        return static_cast<bool>(file);
+    }
+
+private:
+    struct Column {
+        std::string name;
+        std::uint32_t type;
+        std::uint32_t valuesPerRow;
+        std::vector<std::uint64_t> words;
+    };
+
+    static void appendLittleEndian(std::vector<unsigned char>& bytes, std::uint64_t value, int size) {
+        for (int i = 0; i < size; ++i) {
+            bytes.push_back(static_cast<unsigned char>(value >> (8 * i)));
+        }
+    }
+
+    std::uint64_t rowCount;
+    std::vector<Column> columns;
+};
+
+/**
+ * @brief Writes every bankroll's results as a columnar file (see above).
+ * The histogram columns are only written when some bankroll was charted; a bankroll
+ * without a chart has all-zero bins.
+ * @return false if the file could not be written.
+ */
+inline bool writeResultsFile(const std::string& path, std::uint64_t masterSeed, const std::vector<ScenarioResult>& results) {
+    std::size_t bins = 0;
+    for (const ScenarioResult& result : results) {
+        if (result.histogram.weights.size() > bins) bins = result.histogram.weights.size();
+    }
+
+    std::vector<std::int64_t> mode, seed, betsPerRun, totalRuns, ruinCount, targetMet;
+    std::vector<double> startBankroll, betAmount, houseWinProb, probability, low, high, relativeError, elapsed;
+    std::vector<double> histogramMin, histogramMax, histogramWidth, histogramWeights;
+    for (const ScenarioResult& result : results) {
+        mode.push_back(static_cast<std::int64_t>(result.mode));
+        seed.push_back(static_cast<std::int64_t>(masterSeed));
+        startBankroll.push_back(result.startBankroll);
+        betAmount.push_back(result.betAmount);
+        houseWinProb.push_back(result.houseWinProb);
+        betsPerRun.push_back(result.betsPerRun);
+        totalRuns.push_back(result.totalRuns);
+        ruinCount.push_back(result.ruinCount);
+        probability.push_back(result.ruinProbability);
+        low.push_back(result.interval.low);
+        high.push_back(result.interval.high);
+        relativeError.push_back(result.relativeError);
+        elapsed.push_back(result.elapsedSeconds);
+        targetMet.push_back(result.adaptive ? (result.targetMet ? 1 : 0) : -1);
+        histogramMin.push_back(result.histogram.minBankroll);
+        histogramMax.push_back(result.histogram.maxBankroll);
+        histogramWidth.push_back(result.histogram.binWidth);
+        for (std::size_t i = 0; i < bins; ++i) {
+            histogramWeights.push_back(i < result.histogram.weights.size() ? result.histogram.weights[i] : 0.0);
+        }
+    }
+
+    ColumnarWriter writer(results.size());
+    writer.addInt64("mode", mode);
+    writer.addInt64("master_seed", seed);
+    writer.addFloat64("start_bankroll", startBankroll);
+    writer.addFloat64("bet_amount", betAmount);
+    writer.addFloat64("house_win_prob", houseWinProb);
+    writer.addInt64("bets_per_run", betsPerRun);
+    writer.addInt64("total_runs", totalRuns);
+    writer.addInt64("ruin_count", ruinCount);
+    writer.addFloat64("ruin_probability", probability);
+    writer.addFloat64("ci95_low", low);
+    writer.addFloat64("ci95_high", high);
+    writer.addFloat64("relative_error", relativeError);
+    writer.addFloat64("elapsed_seconds", elapsed);
+    writer.addInt64("target_met", targetMet);
+    if (bins > 0) {
+        writer.addFloat64("histogram_min_bankroll", histogramMin);
+        writer.addFloat64("histogram_max_bankroll", histogramMax);
+        writer.addFloat64("histogram_bin_width", histogramWidth);
+        writer.addFloat64("histogram_weights", histogramWeights, static_cast<std::uint32_t>(bins));
+    }
+    return writer.write(path);
+}
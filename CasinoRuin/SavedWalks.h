@@ -0,0 +1,139 @@
+#pragma once
+
+#include <cstdint>
+#include <cstring>      // For memcpy and memcmp
+#include <string>
+
+#include "PathRecorder.h" // For MappedFile
+
+/*
+ * Saved walks: where every run of a sweep stood at the end of its horizon, so that a
+ * longer horizon can carry the runs on from there instead of replaying every bet again.
+ *
+ * Bet i of run r is always word i of run r's stream (see Philox.h), so a run of n bets
+ * is exactly the first n bets of the same run at any longer horizon. A run that survived
+ * n bets is then fully described by its bankroll: its generator is at bet n of stream r,
+ * and r is its place in the file. A ruined run stays ruined, so it is carried over as it
+ * is, with the bet it was ruined at for the first-passage times. Continuing every run of
+ * a file from n to N bets (continueLatticeRun, continueBlockRun) gives bit for bit the
+ * sweep a fresh run of N bets would, at the cost of the N - n bets of the survivors only.
+ *
+ * File layout (native byte order, like the path file, see PathRecorder.h):
+ *   WalkFileHeader
+ *   WalkScenarioEntry[scenarioCount]
+ *   WalkState[scenarioCount * runsPerScenario]   (scenario-major)
+ * Like the path file it is written through a mapping, one run's slot at a time, so any
+ * number of threads save runs at once and the file is the same for any thread count.
+ */
+
+const char WALK_FILE_MAGIC[8] = { 'C', 'R', 'W', 'A', 'L', 'K', 'S', '\0' };
+const std::uint32_t WALK_FILE_VERSION = 1;
+
+struct WalkFileHeader {
+    char magic[8];
+    std::uint32_t version;
+    std::uint32_t scenarioCount;
+    std::uint64_t runsPerScenario;
+    std::uint64_t horizon;          // Bets every run has been simulated for (or up to its ruin)
+    std::uint64_t masterSeed;
+    double houseWinProb;
+    double betAmount;
+    std::uint64_t scenarioTableOffset; // Byte offsets from the start of the file
+    std::uint64_t statesOffset;
+};
+
+struct WalkScenarioEntry {
+    double startBankroll;
+    std::int64_t startUnits;
+};
+
+struct WalkState {
+    std::int64_t units;     // Bankroll in bet units after the horizon, or at ruin
+    std::int64_t ruinBet;   // The bet the run was ruined at, or 0 if it survived
+};
+
+/**
+ * @brief A file of saved walks: created and filled by one sweep, read by a later one.
+ * Different runs touch disjoint bytes, so any number of threads may save at once.
+ */
+class SavedWalks {
+public:
+    SavedWalks() : header() {}
+
+    /**
+     * @brief Creates the file, sized for every run, and writes its header.
+     * @return false if the file could not be created.
+     */
+    bool create(const std::string& path, std::uint32_t scenarioCount, std::uint64_t runsPerScenario,
+        std::uint64_t horizon, std::uint64_t masterSeed, double houseWinProb, double betAmount) {
+        std::memcpy(header.magic, WALK_FILE_MAGIC, sizeof(header.magic));
+        header.version = WALK_FILE_VERSION;
+        header.scenarioCount = scenarioCount;
+        header.runsPerScenario = runsPerScenario;
+        header.horizon = horizon;
+        header.masterSeed = masterSeed;
+        header.houseWinProb = houseWinProb;
+        header.betAmount = betAmount;
+        header.scenarioTableOffset = sizeof(WalkFileHeader);
+        header.statesOffset = header.scenarioTableOffset + scenarioCount * sizeof(WalkScenarioEntry);
+        const std::uint64_t size = header.statesOffset + static_cast<std::uint64_t>(scenarioCount) * runsPerScenario * sizeof(WalkState);
+
+        if (!file.create(path, size)) return false;
+        std::memcpy(file.data(), &header, sizeof(header));
+        return true;
+    }
+
+    /**
+     * @brief Maps a file written by an earlier sweep, read-only.
+     * @return false if it is missing, not a walk file, or shorter than its header says.
+     */
+    bool open(const std::string& path) {
+        if (!file.openReadOnly(path) || file.size() < sizeof(WalkFileHeader)) return false;
+        std::memcpy(&header, file.data(), sizeof(header));
+        if (std::memcmp(header.magic, WALK_FILE_MAGIC, sizeof(header.magic)) != 0 || header.version != WALK_FILE_VERSION) return false;
+        const std::uint64_t size = header.statesOffset + static_cast<std::uint64_t>(header.scenarioCount) * header.runsPerScenario * sizeof(WalkState);
+        return header.statesOffset >= header.scenarioTableOffset + header.scenarioCount * sizeof(WalkScenarioEntry)
+            && file.size() >= size;
+    }
+
+    bool isOpen() const { return file.data() != nullptr; }
+    const WalkFileHeader& info() const { return header; }
+
+    void describeScenario(std::uint32_t scenarioId, double startBankroll, std::int64_t startUnits) {
+        WalkScenarioEntry entry;
+        entry.startBankroll = startBankroll;
+        entry.startUnits = startUnits;
+        std::memcpy(file.data() + header.scenarioTableOffset + scenarioId * sizeof(WalkScenarioEntry), &entry, sizeof(entry));
+    }
+
+    WalkScenarioEntry scenario(std::uint32_t scenarioId) const {
+        WalkScenarioEntry entry;
+        std::memcpy(&entry, file.data() + header.scenarioTableOffset + scenarioId * sizeof(WalkScenarioEntry), sizeof(entry));
+        return entry;
+    }
+
+    WalkState state(std::uint32_t scenarioId, long long runIndex) const {
+        WalkState walk;
+        std::memcpy(&walk, file.data() + stateOffset(scenarioId, runIndex), sizeof(walk));
+        return walk;
+    }
+
+    /**
+     * @param ruinBet The bet the run was ruined at, or 0 if it survived.
+     */
+    void saveState(std::uint32_t scenarioId, long long runIndex, std::int64_t units, long long ruinBet) {
+        WalkState walk;
+        walk.units = units;
+        walk.ruinBet = ruinBet;
+        std::memcpy(file.data() + stateOffset(scenarioId, runIndex), &walk, sizeof(walk));
+    }
+
+private:
+    std::uint64_t stateOffset(std::uint32_t scenarioId, long long runIndex) const {
+        std::uint64_t slot = static_cast<std::uint64_t>(scenarioId) * header.runsPerScenario + static_cast<std::uint64_t>(runIndex);
+        return header.statesOffset + slot * sizeof(WalkState);
+    }
+
+    WalkFileHeader header;
+    MappedFile file;
+};
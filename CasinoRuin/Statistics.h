@@ -0,0 +1,310 @@
+#pragma once
+
+#include <algorithm>    // For sort, min and max
+#include <condition_variable> // For chunks that finish too far ahead
+#include <cstdint>
+#include <limits>
+#include <map>          // For chunks that finish out of order
+#include <mutex>
+#include <utility>      // For move and pair
+#include <vector>
+
+#include "Philox.h"     // For splitMix64
+
+/*
+ * Mergeable statistics of the final bankroll, in memory that does not grow with the
+ * number of runs. Every accumulator can be filled separately (per chunk, per thread or
+ * per process) and combined at the end.
+ */
+
+/**
+ * @brief Count, mean, variance and extrema, updated one value at a time (Welford) and
+ * combined exactly, up to rounding, by Chan et al.'s pairwise formula.
+ */
+struct RunningMoments {
+    long long count = 0;
+    double mean = 0.0;
+    double sumSquaredDeviations = 0.0;
+    double minimum = std::numeric_limits<double>::infinity();
+    double maximum = -std::numeric_limits<double>::infinity();
+
+    void add(double value) {
+        ++count;
+        double delta = value - mean;
+        mean += delta / static_cast<double>(count);
+        sumSquaredDeviations += delta * (value - mean);
+        minimum = std::min(minimum, value);
+        maximum = std::max(maximum, value);
+    }
+
+    void merge(const RunningMoments& other) {
+        if (other.count == 0) return;
+        if (count == 0) {
+            *this = other;
+            return;
+        }
+        long long combined = count + other.count;
+        double delta = other.mean - mean;
+        mean += delta * static_cast<double>(other.count) / static_cast<double>(combined);
+        sumSquaredDeviations += other.sumSquaredDeviations
+            + delta * delta * static_cast<double>(count) * static_cast<double>(other.count) / static_cast<double>(combined);
+        count = combined;
+        minimum = std::min(minimum, other.minimum);
+        maximum = std::max(maximum, other.maximum);
+    }
+
+    /**
+     * @brief The sample variance (n - 1 in the denominator).
+     */
+    double variance() const {
+        return (count > 1) ? sumSquaredDeviations / static_cast<double>(count - 1) : 0.0;
+    }
+
+    /**
+     * @brief Writes the exact state to a checkpoint (see Checkpoint.h).
+     */
+    template <typename Writer>
+    void save(Writer& out) const {
+        out.putInt(count);
+        out.putDouble(mean);
+        out.putDouble(sumSquaredDeviations);
+        out.putDouble(minimum);
+        out.putDouble(maximum);
+    }
+
+    template <typename Reader>
+    bool load(Reader& in) {
+        count = in.getInt();
+        mean = in.getDouble();
+        sumSquaredDeviations = in.getDouble();
+        minimum = in.getDouble();
+        maximum = in.getDouble();
+        return in.ok();
+    }
+};
+
+/**
+ * @brief A KLL quantile sketch (Karnin, Lang and Liberty, 2016).
+ *
+ * Values are kept in levels; an item on level h stands for 2^h of the values added.
+ * When a level outgrows its capacity it is sorted and every other item moves up a level.
+ * Capacities shrink by 2/3 per level below the top, down to a floor of 2, so the sketch
+ * holds O(k + log(n / k)) items for n values: under a thousand doubles for k = 200, even
+ * at 1e10 runs. Every quantile's rank is typically within about 1.5% of
+ * n at k = 200, and merging sketches keeps the same accuracy.
+ *
+ * Which half of a level survives a compaction is chosen by a coin from a fixed SplitMix64
+ * sequence, so filling and merging in the same order always gives the same sketch.
+ */
+class QuantileSketch {
+public:
+    explicit QuantileSketch(int k = 200) : k(k), valueCount(0), coinState(0), levels(1) {}
+
+    void add(double value) {
+        levels[0].push_back(value);
+        ++valueCount;
+        if (levels[0].size() >= capacity(0)) {
+            compress();
+        }
+    }
+
+    void merge(const QuantileSketch& other) {
+        if (other.levels.size() > levels.size()) {
+            levels.resize(other.levels.size());
+        }
+        for (std::size_t h = 0; h < other.levels.size(); ++h) {
+            levels[h].insert(levels[h].end(), other.levels[h].begin(), other.levels[h].end());
+        }
+        valueCount += other.valueCount;
+        coinState ^= other.coinState;
+        compress();
+    }
+
+    long long count() const { return valueCount; }
+
+    /**
+     * @brief The value below which roughly the given fraction (0.0 to 1.0) of all values lie.
+     */
+    double quantile(double fraction) const {
+        std::vector<std::pair<double, std::uint64_t>> weighted;
+        std::uint64_t totalWeight = 0;
+        for (std::size_t h = 0; h < levels.size(); ++h) {
+            for (double value : levels[h]) {
+                weighted.push_back(std::make_pair(value, 1ULL << h));
+                totalWeight += 1ULL << h;
+            }
+        }
+        if (weighted.empty()) return 0.0;
+        std::sort(weighted.begin(), weighted.end());
+
+        double target = fraction * static_cast<double>(totalWeight);
+        std::uint64_t cumulative = 0;
+        for (const std::pair<double, std::uint64_t>& item : weighted) {
+            cumulative += item.second;
+            if (static_cast<double>(cumulative) >= target) {
+                return item.first;
+            }
+        }
+        return weighted.back().first;
+    }
+
+    /**
+     * @brief Writes the exact state, coin included, to a checkpoint (see Checkpoint.h),
+     * so a sketch read back goes on to compact exactly as the original would have.
+     */
+    template <typename Writer>
+    void save(Writer& out) const {
+        out.putInt(k);
+        out.putInt(valueCount);
+        out.putWord(coinState);
+        out.putInt(static_cast<std::int64_t>(levels.size()));
+        for (const std::vector<double>& level : levels) {
+            out.putInt(static_cast<std::int64_t>(level.size()));
+            for (double value : level) out.putDouble(value);
+        }
+    }
+
+    template <typename Reader>
+    bool load(Reader& in) {
+        k = static_cast<int>(in.getInt());
+        valueCount = in.getInt();
+        coinState = in.getWord();
+        levels.assign(in.getCount(), std::vector<double>());
+        for (std::vector<double>& level : levels) {
+            level.assign(in.getCount(), 0.0);
+            for (double& value : level) value = in.getDouble();
+        }
+        return in.ok() && k > 0 && !levels.empty();
+    }
+
+private:
+    /**
+     * @brief Items level h may hold: k on the top level, shrinking by 2/3 per level below it.
+     */
+    std::size_t capacity(std::size_t h) const {
+        double size = static_cast<double>(k);
+        for (std::size_t depth = levels.size() - 1; depth > h; --depth) {
+            size *= 2.0 / 3.0;
+        }
+        return std::max<std::size_t>(2, static_cast<std::size_t>(size));
+    }
+
+    /**
+     * @brief Compacts every level that is over capacity, from the bottom up.
+     */
+    void compress() {
+        for (std::size_t h = 0; h < levels.size(); ++h) {
+            if (levels[h].size() < capacity(h)) continue;
+            if (h + 1 == levels.size()) {
+                levels.resize(levels.size() + 1);
+            }
+
+            std::vector<double>& level = levels[h];
+            std::sort(level.begin(), level.end());
+
+            // An odd item out stays behind; of the rest, every other one moves up
+            std::size_t keepBehind = level.size() % 2;
+            std::size_t offset = static_cast<std::size_t>(splitMix64(coinState) & 1u);
+            for (std::size_t i = keepBehind + offset; i < level.size(); i += 2) {
+                levels[h + 1].push_back(level[i]);
+            }
+            level.resize(keepBehind);
+        }
+    }
+
+    int k;
+    long long valueCount;
+    std::uint64_t coinState;
+    std::vector<std::vector<double>> levels;
+};
+
+/**
+ * @brief Everything collected about the final bankrolls of a set of runs.
+ */
+struct BankrollStatistics {
+    RunningMoments moments;
+    QuantileSketch quantiles;
+
+    void add(double bankroll) {
+        moments.add(bankroll);
+        quantiles.add(bankroll);
+    }
+
+    void merge(const BankrollStatistics& other) {
+        moments.merge(other.moments);
+        quantiles.merge(other.quantiles);
+    }
+
+    template <typename Writer>
+    void save(Writer& out) const {
+        moments.save(out);
+        quantiles.save(out);
+    }
+
+    template <typename Reader>
+    bool load(Reader& in) {
+        return moments.load(in) && quantiles.load(in);
+    }
+};
+
+/**
+ * @brief Merges per-chunk results in run order, whichever thread finishes first.
+ *
+ * Floating-point merges are not associative, so merging in the order threads finish
+ * would make the last digits depend on the thread count. Chunks that finish early are
+ * parked here until every chunk before them is merged. One slow chunk could let the other
+ * threads finish any number of chunks past it, so at most maxPending are parked: a thread
+ * with one more waits in submit until the chunks before it come in. The chunk due next
+ * never waits, and a thread claims its next chunk only after handing in the last one, so
+ * the thread holding the chunk due next is never among those waiting. Memory is at most
+ * maxPending results, however many runs there are. Chunks are known by their runs rather
+ * than an index, so they need not line up with any fixed chunk grid.
+ */
+template <typename T>
+class OrderedMerge {
+public:
+    explicit OrderedMerge(std::size_t maxPending = 64) : nextRun(0), maxPending(maxPending) {}
+
+    /**
+     * @brief Hands in the result of runs [firstRun, endRun).
+     */
+    void submit(long long firstRun, long long endRun, T&& part) {
+        std::unique_lock<std::mutex> lock(mutex);
+        chunkMerged.wait(lock, [&] { return firstRun == nextRun || pending.size() < maxPending; });
+        pending.insert(std::make_pair(firstRun, std::make_pair(endRun, std::move(part))));
+        bool merged = false;
+        while (!pending.empty() && pending.begin()->first == nextRun) {
+            total.merge(pending.begin()->second.second);
+            nextRun = pending.begin()->second.first;
+            pending.erase(pending.begin());
+            merged = true;
+        }
+        if (merged) {
+            chunkMerged.notify_all();
+        }
+    }
+
+    /**
+     * @brief The merged result; call once every chunk has been submitted.
+     */
+    const T& result() const { return total; }
+
+    /**
+     * @brief Continues from a checkpoint: merged is the result of runs 0 to runsDone - 1,
+     * and the next chunk submitted starts at runsDone.
+     */
+    void resume(const T& merged, long long runsDone) {
+        std::lock_guard<std::mutex> lock(mutex);
+        total = merged;
+        nextRun = runsDone;
+        pending.clear();
+    }
+
+private:
+    std::mutex mutex;
+    std::condition_variable chunkMerged;
+    long long nextRun;
+    std::size_t maxPending;
+    std::map<long long, std::pair<long long, T>> pending;  // First run -> (end run, result)
+    T total;
+};
@@ -0,0 +1,242 @@
+#pragma once
+
+#include <algorithm>    // For sort
+#include <cstdint>
+#include <limits>
+#include <vector>
+
+#include "ThreadPool.h"
+#include "Lattice.h"
+#include "Philox.h"
+#include "Bernoulli.h"
+#include "BlockKernel.h" // Pattern generators and the 8-bet step table
+#include "Histogram.h"  // For the final bankrolls of each level
+#include "Statistics.h" // ... and their moments and quantiles
+
+/*
+ * Sweeping every bankroll with one set of walks.
+ *
+ * Whether a run is ruined depends only on the lowest point its walk reaches relative
+ * to the start: a bankroll of s units is ruined exactly when the walk's displacement
+ * reaches RUIN_THRESHOLD_UNITS - 1 - s. So each walk is simulated once, to the end and
+ * without stopping at ruin, and summarised by its running minimum, its final
+ * displacement and the bet at which it first reached each bankroll's ruin level. Every
+ * bankroll is then answered from the same summaries, so a sweep costs one bankroll's
+ * worth of simulation, and all bankrolls see common random numbers: the differences
+ * between them are not blurred by independent noise. A summary is added to every
+ * bankroll's tally as soon as its walk ends, so memory does not grow with the runs.
+ *
+ * The walks use the same streams as the regular engines, so the first bankroll's
+ * results (scenario 0) are bit-identical to simulating it on its own.
+ */
+
+/**
+ * @brief What one walk needs to answer every bankroll of a sweep at once.
+ */
+struct WalkSummary {
+    std::int64_t finalDisplacement; // Units won (+) or lost (-) over all the bets
+    std::int64_t minimum;           // Lowest displacement after any bet
+};
+
+/**
+ * @brief The displacement at which a bankroll of startUnits is ruined.
+ */
+inline std::int64_t sweepRuinLevel(std::int64_t startUnits) {
+    return RUIN_THRESHOLD_UNITS - 1 - startUnits;
+}
+
+/**
+ * @brief The final bankroll, in units, of one walk for a given starting bankroll.
+ * A ruined walk stops where it crossed the threshold, like the regular engines.
+ */
+inline std::int64_t sweepFinalUnits(const WalkSummary& walk, std::int64_t startUnits) {
+    if (walk.minimum <= sweepRuinLevel(startUnits)) {
+        return RUIN_THRESHOLD_UNITS - 1;
+    }
+    return startUnits + walk.finalDisplacement;
+}
+
+/**
+ * @brief Simulates one whole walk, 8 bets per table lookup, and summarises it.
+ * @param generate The pattern generator for this CPU (see selectBetPatternGenerator).
+ * @param streamKey The key of the random streams.
+ * @param numBets The number of bets in the walk.
+ * @param houseWin The house's win probability as a precomputed threshold (see makeBernoulliThreshold).
+ * @param runIndex The index of this run, which selects its own random stream.
+ * @param levels Ruin levels (see sweepRuinLevel) in descending order, i.e. ascending bankroll.
+ * @param passageTimes Receives, for each level, the number of bets after which the walk first
+ * reached it, or -1 if it never did.
+ */
+inline WalkSummary summarizeWalk(BetPatternGenerator generate, PhiloxKey streamKey, long long numBets,
+    const BernoulliThreshold& houseWin, long long runIndex, const std::vector<std::int64_t>& levels, long long* passageTimes) {
+    const BlockStepTable& table = blockStepTable();
+    const std::size_t numLevels = levels.size();
+    for (std::size_t k = 0; k < numLevels; ++k) passageTimes[k] = -1;
+
+    WalkSummary walk;
+    walk.finalDisplacement = 0;
+    walk.minimum = std::numeric_limits<std::int64_t>::max();
+
+    // The next level not reached yet; the walk reaches them in order
+    std::size_t pending = 0;
+    std::int64_t pendingLevel = (numLevels > 0) ? levels[0] : std::numeric_limits<std::int64_t>::min();
+
+    std::int64_t position = 0;
+    for (long long firstBet = 0; firstBet < numBets; firstBet += BETS_PER_PATTERN) {
+        std::uint64_t pattern = generate(streamKey, static_cast<std::uint64_t>(runIndex), static_cast<std::uint64_t>(firstBet), houseWin);
+        long long betsInPattern = numBets - firstBet;
+        if (betsInPattern > BETS_PER_PATTERN) betsInPattern = BETS_PER_PATTERN;
+
+        for (int offset = 0; offset < betsInPattern; offset += BETS_PER_TABLE_ENTRY) {
+            unsigned bits = static_cast<unsigned>(pattern >> offset) & 0xFFu;
+
+            // Fast path: a whole byte that reaches no new level
+            if (betsInPattern - offset >= BETS_PER_TABLE_ENTRY && position + table.minPrefix[bits] > pendingLevel) {
+                std::int64_t low = position + table.minPrefix[bits];
+                if (low < walk.minimum) walk.minimum = low;
+                position += table.net[bits];
+                continue;
+            }
+
+            // Slow path: step bet by bet to time each level the byte reaches (or the final partial byte)
+            long long betsInByte = betsInPattern - offset;
+            if (betsInByte > BETS_PER_TABLE_ENTRY) betsInByte = BETS_PER_TABLE_ENTRY;
+            for (int t = 0; t < betsInByte; ++t) {
+                position += ((bits >> t) & 1u) ? 1 : -1;
+                if (position < walk.minimum) walk.minimum = position;
+                while (pending < numLevels && position <= pendingLevel) {
+                    passageTimes[pending] = firstBet + offset + t + 1;
+                    ++pending;
+                    pendingLevel = (pending < numLevels) ? levels[pending] : std::numeric_limits<std::int64_t>::min();
+                }
+            }
+        }
+    }
+
+    walk.finalDisplacement = position;
+    return walk;
+}
+
+/**
+ * @brief What a sweep collects for one bankroll, added up walk by walk.
+ */
+struct SweepTally {
+    long long ruinCount = 0;
+    long long totalBetsToRuin = 0;  // Over the ruined walks
+    LatticeHistogram histogram;     // Every walk's final bankroll, if they are kept
+    BankrollStatistics statistics;  // ... and their moments and quantiles
+
+    void merge(const SweepTally& other) {
+        ruinCount += other.ruinCount;
+        totalBetsToRuin += other.totalBetsToRuin;
+        histogram.merge(other.histogram);
+    }
+};
+
+/**
+ * @brief One chunk's statistics for every level of a sweep, merged in run order by OrderedMerge.
+ */
+struct SweepStatistics {
+    std::vector<BankrollStatistics> levels;
+
+    void merge(const SweepStatistics& other) {
+        if (levels.size() < other.levels.size()) {
+            levels.resize(other.levels.size());
+        }
+        for (std::size_t k = 0; k < other.levels.size(); ++k) {
+            levels[k].merge(other.levels[k]);
+        }
+    }
+};
+
+/**
+ * @brief Simulates totalRuns walks once each, sharded across the pool, and tallies every
+ * bankroll from each walk as it ends. Counts are integers and the statistics are merged
+ * chunk by chunk in run order, so the results do not depend on the thread count.
+ * @param levels Ruin levels (see sweepRuinLevel) in descending order.
+ * @param lattices The lattice of each level's bankroll, in the same order, to keep every
+ * walk's final bankroll as well: a histogram (numBets + 1 counters per level and thread)
+ * and statistics per level. Empty to only count ruins.
+ * @return The tally of each level, in the order of levels.
+ */
+inline std::vector<SweepTally> simulateSweep(ThreadPool& pool, BetPatternGenerator generate, PhiloxKey streamKey, long long numBets,
+    const BernoulliThreshold& houseWin, long long totalRuns, long long runsPerChunk, const std::vector<std::int64_t>& levels,
+    const std::vector<LatticeScenario>& lattices) {
+    const std::size_t numLevels = levels.size();
+    const bool keepFinalBankrolls = !lattices.empty();
+
+    // One tally per level and thread
+    std::vector<CacheLinePadded<std::vector<SweepTally>>> talliesByThread(pool.size());
+    for (CacheLinePadded<std::vector<SweepTally>>& slot : talliesByThread) {
+        slot.value.resize(numLevels);
+        for (std::size_t k = 0; k < numLevels && keepFinalBankrolls; ++k) {
+            slot.value[k].histogram = LatticeHistogram(lattices[k].startUnits, numBets);
+        }
+    }
+
+    // Moments and quantiles are merged chunk by chunk in run order, like the Monte Carlo path's
+    OrderedMerge<SweepStatistics> statisticsByChunk;
+
+    pool.parallelFor(totalRuns, runsPerChunk, [&](unsigned threadIndex, long long begin, long long end) {
+        std::vector<SweepTally>& tallies = talliesByThread[threadIndex].value;
+
+        // Ruins are counted per chunk and added to the thread's tallies once, at its end
+        std::vector<long long> passageTimes(numLevels);
+        std::vector<long long> ruins(numLevels, 0);
+        std::vector<long long> betsToRuin(numLevels, 0);
+        SweepStatistics statistics;
+        statistics.levels.resize(keepFinalBankrolls ? numLevels : 0);
+        for (long long i = begin; i < end; ++i) {
+            WalkSummary walk = summarizeWalk(generate, streamKey, numBets, houseWin, i, levels, passageTimes.data());
+            for (std::size_t k = 0; k < numLevels; ++k) {
+                if (passageTimes[k] >= 0) {
+                    ruins[k]++;
+                    betsToRuin[k] += passageTimes[k];
+                }
+                if (keepFinalBankrolls) {
+                    std::int64_t units = sweepFinalUnits(walk, lattices[k].startUnits);
+                    tallies[k].histogram.add(units);
+                    statistics.levels[k].add(unitsToDollars(lattices[k], units));
+                }
+            }
+        }
+        for (std::size_t k = 0; k < numLevels; ++k) {
+            tallies[k].ruinCount += ruins[k];
+            tallies[k].totalBetsToRuin += betsToRuin[k];
+        }
+        if (keepFinalBankrolls) {
+            statisticsByChunk.submit(begin, end, std::move(statistics));
+        }
+    });
+
+    // Merge the per-thread tallies
+    std::vector<SweepTally> merged = talliesByThread[0].value;
+    for (std::size_t t = 1; t < talliesByThread.size(); ++t) {
+        for (std::size_t k = 0; k < numLevels; ++k) {
+            merged[k].merge(talliesByThread[t].value[k]);
+        }
+    }
+    for (std::size_t k = 0; k < numLevels && keepFinalBankrolls; ++k) {
+        merged[k].statistics = statisticsByChunk.result().levels[k];
+    }
+    return merged;
+}
+
+/**
+ * @brief The ruin levels of a set of bankrolls, in the descending order simulateSweep needs.
+ * @param startUnits The starting bankroll of each scenario, in bet units.
+ * @param levelIndex Receives, for each scenario, the index of its level in the result.
+ */
+inline std::vector<std::int64_t> sortedSweepLevels(const std::vector<std::int64_t>& startUnits, std::vector<std::size_t>& levelIndex) {
+    std::vector<std::size_t> order(startUnits.size());
+    for (std::size_t i = 0; i < order.size(); ++i) order[i] = i;
+    std::sort(order.begin(), order.end(), [&](std::size_t a, std::size_t b) { return startUnits[a] < startUnits[b]; });
+
+    std::vector<std::int64_t> levels(order.size());
+    levelIndex.assign(order.size(), 0);
+    for (std::size_t k = 0; k < order.size(); ++k) {
+        levels[k] = sweepRuinLevel(startUnits[order[k]]);
+        levelIndex[order[k]] = k;
+    }
+    return levels;
+}
@@ -0,0 +1,152 @@
+#pragma once
+
+#include <algorithm>            // For std::min
+#include <atomic>               // For the shared chunk counter
+#include <condition_variable>   // To park idle workers
+#include <functional>           // For the job handed to every worker
+#include <mutex>
+#include <thread>
+#include <vector>
+
+// Size of a cache line on every x86-64 and most ARM cores we run on.
+const std::size_t CACHE_LINE_SIZE = 64;
+
+/**
+ * @brief Wraps a per-thread value so that two threads' copies never share a cache line.
+ * We pad with a full line instead of using alignas so the padding still works
+ * when the slots live in a std::vector (over-aligned allocation needs C++17).
+ */
+template <typename T>
+struct CacheLinePadded {
+    T value;
+    char padding[CACHE_LINE_SIZE];
+};
+
+/**
+ * @brief A fixed set of worker threads that is created once and reused for every parallel loop.
+ * The calling thread takes part in the work as thread 0, so a pool of N threads
+ * starts only N - 1 extra threads.
+ */
+class ThreadPool {
+public:
+    /**
+     * @param numThreads The number of threads to use, including the caller.
+     * 0 means one per hardware thread.
+     */
+    explicit ThreadPool(unsigned numThreads = 0) {
+        if (numThreads == 0) {
+            numThreads = std::thread::hardware_concurrency();
+        }
+        threadCount = (numThreads == 0) ? 1 : numThreads;
+
+        for (unsigned t = 1; t < threadCount; ++t) {
+            workers.emplace_back(&ThreadPool::workerLoop, this, t);
+        }
+    }
+
+    ~ThreadPool() {
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            shuttingDown = true;
+        }
+        wakeWorkers.notify_all();
+        for (std::thread& worker : workers) {
+            worker.join();
+        }
+    }
+
+    ThreadPool(const ThreadPool&) = delete;
+    ThreadPool& operator=(const ThreadPool&) = delete;
+
+    /**
+     * @brief The number of threads that take part in each parallel loop.
+     */
+    unsigned size() const { return threadCount; }
+
+    /**
+     * @brief Splits [0, total) into chunks and hands them out to the threads until none are left.
+     * Chunks are claimed dynamically, so threads that draw short runs (e.g. early ruin)
+     * simply take more chunks. Blocks until every chunk is done.
+     * @param total The number of work items (runs).
+     * @param chunkSize The number of items a thread claims at once.
+     * @param body Called as body(threadIndex, begin, end) for each claimed chunk.
+     */
+    template <typename Body>
+    void parallelFor(long long total, long long chunkSize, Body body) {
+        parallelForRange(0, total, chunkSize, body);
+    }
+
+    /**
+     * @brief parallelFor over [first, last): chunks start at first, first + chunkSize, ...
+     * so a range that starts on a chunk boundary continues the chunking of the one before it.
+     */
+    template <typename Body>
+    void parallelForRange(long long first, long long last, long long chunkSize, Body body) {
+        if (chunkSize < 1) chunkSize = 1;
+        std::atomic<long long> nextItem(first);
+
+        runOnAllThreads([&](unsigned threadIndex) {
+            for (;;) {
+                long long begin = nextItem.fetch_add(chunkSize);
+                if (begin >= last) {
+                    break;
+                }
+                body(threadIndex, begin, std::min(begin + chunkSize, last));
+            }
+        });
+    }
+
+private:
+    /**
+     * @brief Runs job(threadIndex) once on every thread of the pool and waits for all of them.
+     */
+    void runOnAllThreads(const std::function<void(unsigned)>& job) {
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            currentJob = &job;
+            busyWorkers = threadCount - 1;
+            ++generation;
+        }
+        wakeWorkers.notify_all();
+
+        job(0);
+
+        std::unique_lock<std::mutex> lock(mutex);
+        jobFinished.wait(lock, [this] { return busyWorkers == 0; });
+        currentJob = nullptr;
+    }
+
+    void workerLoop(unsigned threadIndex) {
+        unsigned long long seenGeneration = 0;
+        for (;;) {
+            const std::function<void(unsigned)>* job;
+            {
+                std::unique_lock<std::mutex> lock(mutex);
+                wakeWorkers.wait(lock, [&] { return shuttingDown || generation != seenGeneration; });
+                if (shuttingDown) {
+                    return;
+                }
+                seenGeneration = generation;
+                job = currentJob;
+            }
+
+            (*job)(threadIndex);
+
+            std::lock_guard<std::mutex> lock(mutex);
+            if (--busyWorkers == 0) {
+                jobFinished.notify_one();
+            }
+        }
+    }
+
+    unsigned threadCount;
+    std::vector<std::thread> workers;
+
+    std::mutex mutex;
+    std::condition_variable wakeWorkers;
+    std::condition_variable jobFinished;
+    const std::function<void(unsigned)>* currentJob = nullptr;
+    unsigned busyWorkers = 0;
+    unsigned long long generation = 0;
+    bool shuttingDown = false;
+};